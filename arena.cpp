@@ -0,0 +1,42 @@
+#include "arena.h"
+
+// ---------------- PhaseArena ----------------
+std::atomic<size_t> PhaseArena::peaks[PhaseArena::kNumPhases];
+
+void* PhaseArena::CountingResource::do_allocate(size_t n, size_t alignment) {
+    bytes += n;
+    size_t seen = peaks[phase].load();
+    while (bytes > seen && !peaks[phase].compare_exchange_weak(seen, bytes)) {
+    }
+    return buffer->allocate(n, alignment);
+}
+
+void PhaseArena::CountingResource::do_deallocate(void* p, size_t n, size_t alignment) {
+    buffer->deallocate(p, n, alignment);
+}
+
+bool PhaseArena::CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+PhaseArena::PhaseArena(Phase phase, size_t initialBytes) : buffer(initialBytes), counter(phase, &buffer) {}
+
+size_t PhaseArena::highWater(Phase phase) {
+    return peaks[phase].load();
+}
+
+const char* PhaseArena::phaseName(Phase phase) {
+    switch (phase) {
+        case PARSE: return "parse";
+        case CIRCUIT: return "circuit";
+        case CNF: return "cnf";
+        default: return "?";
+    }
+}
+
+void PhaseArena::report(std::ostream& out) {
+    for (int p = 0; p < kNumPhases; p++) {
+        out << (p ? ", " : "") << phaseName(static_cast<Phase>(p)) << " "
+            << highWater(static_cast<Phase>(p)) << " B";
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+
+// ---------------- PhaseArena ----------------
+// Monotonic arena for the short-lived allocations of one pipeline phase (parse, circuit
+// passes, CNF generation). Allocations only bump a pointer; nothing is freed until the
+// arena is destroyed, which releases every block at once. The most bytes allocated from a
+// single arena per phase are kept as a process-wide high-water mark (what the phase used,
+// not the blocks reserved from the heap for it).
+class PhaseArena {
+public:
+    enum Phase { PARSE, CIRCUIT, CNF, kNumPhases };
+
+    explicit PhaseArena(Phase phase, size_t initialBytes = 64 * 1024);
+    PhaseArena(const PhaseArena&) = delete;
+    PhaseArena& operator=(const PhaseArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &counter; }
+    // Bytes allocated from the arena so far
+    size_t bytesAllocated() const { return counter.bytes; }
+
+    static size_t highWater(Phase phase);
+    static const char* phaseName(Phase phase);
+    // One line: "<phase> <bytes> ..." for every phase
+    static void report(std::ostream& out);
+
+private:
+    // Counts what is allocated from the monotonic buffer and raises the phase peak
+    struct CountingResource : std::pmr::memory_resource {
+        Phase phase;
+        std::pmr::memory_resource* buffer;
+        size_t bytes = 0;
+        CountingResource(Phase phase, std::pmr::memory_resource* buffer) : phase(phase), buffer(buffer) {}
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    std::pmr::monotonic_buffer_resource buffer;
+    CountingResource counter;
+
+    static std::atomic<size_t> peaks[kNumPhases];
+};
+
+#endif // ARENA_H
@@ -0,0 +1,493 @@
+#include "arithmetic.h"
+#include <map>
+
+// ---------------- ArithmeticBuilder ----------------
+namespace {
+
+// Generate / propagate signals of an addition, built on first use. Bit 0 folds in the
+// carry-in: with carryIn, g0 = a0 | b0 (a0 + b0 + 1 carries unless both are 0).
+// Prefix cells combine (G, P) pairs of adjacent ranges: G = Ghi | Phi & Glo, P = Phi & Plo.
+class CarryNetwork {
+public:
+    CarryNetwork(LogicCircuit& circuit, const std::vector<std::string>& a, const std::vector<std::string>& b,
+                 bool carryIn)
+        : circuit(circuit), a(a), b(b), carryIn(carryIn) {
+        for (size_t i = 0; i < a.size(); i++) cells.push_back({-1, -1, "", ""});
+    }
+
+    // Cell i < width is the single bit i
+    int combine(int hi, int lo) {
+        cells.push_back({hi, lo, "", ""});
+        return static_cast<int>(cells.size() - 1);
+    }
+
+    const std::string& generate(int c) {
+        Cell& cell = cells[c];
+        if (!cell.g.empty()) return cell.g;
+        std::string g = circuit.newTemp();
+        if (cell.hi < 0) {
+            bool first = c == 0 && carryIn;
+            circuit.addGate(Gate(first ? Gate::Type::OR : Gate::Type::AND, {a[c], b[c]}, g));
+        } else {
+            std::string through = circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::AND, {propagate(cells[c].hi), generate(cells[c].lo)}, through));
+            circuit.addGate(Gate(Gate::Type::OR, {generate(cells[c].hi), through}, g));
+        }
+        cells[c].g = g;
+        return cells[c].g;
+    }
+
+    const std::string& propagate(int c) {
+        Cell& cell = cells[c];
+        if (!cell.p.empty()) return cell.p;
+        std::string p = circuit.newTemp();
+        if (cell.hi < 0) {
+            circuit.addGate(Gate(Gate::Type::XOR, {a[c], b[c]}, p));
+        } else {
+            circuit.addGate(Gate(Gate::Type::AND, {propagate(cells[c].hi), propagate(cells[c].lo)}, p));
+        }
+        cells[c].p = p;
+        return cells[c].p;
+    }
+
+    // Bit sums from the carry into every bit (carries[i] for i >= 1)
+    void sums(const std::vector<std::string>& carries, const std::vector<std::string>& sum) {
+        circuit.addGate(Gate(carryIn ? Gate::Type::XNOR : Gate::Type::XOR, {a[0], b[0]}, sum[0]));
+        for (size_t i = 1; i < sum.size(); i++) {
+            circuit.addGate(Gate(Gate::Type::XOR, {propagate(static_cast<int>(i)), carries[i]}, sum[i]));
+        }
+    }
+
+private:
+    struct Cell {
+        int hi, lo;          // -1 for single-bit cells
+        std::string g, p;    // empty until built
+    };
+
+    LogicCircuit& circuit;
+    const std::vector<std::string>& a;
+    const std::vector<std::string>& b;
+    bool carryIn;
+    std::vector<Cell> cells;
+};
+
+// Unsigned magnitude comparison of a[lo, hi) and b[lo, hi), split at the middle. Range
+// equalities are built on first use and shared: the tree only asks for upper halves.
+class MagnitudeTree {
+public:
+    MagnitudeTree(LogicCircuit& circuit, const std::vector<std::string>& a, const std::vector<std::string>& b)
+        : circuit(circuit), a(a), b(b) {}
+
+    // a[lo, hi) < b[lo, hi), driven into `out`
+    void less(size_t lo, size_t hi, const std::string& out) {
+        if (hi - lo == 1) {
+            std::string notA = circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::NOT, {a[lo]}, notA));
+            circuit.addGate(Gate(Gate::Type::AND, {notA, b[lo]}, out));
+            return;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        std::string upper = circuit.newTemp(), lower = circuit.newTemp();
+        less(mid, hi, upper);
+        less(lo, mid, lower);
+        circuit.addGate(Gate(Gate::Type::MUX, {upper, lower, equal(mid, hi)}, out));
+    }
+
+    // a[lo, hi) == b[lo, hi)
+    const std::string& equal(size_t lo, size_t hi) {
+        auto it = equalities.find({lo, hi});
+        if (it != equalities.end()) return it->second;
+        std::string eq = circuit.newTemp();
+        if (hi - lo == 1) {
+            circuit.addGate(Gate(Gate::Type::XNOR, {a[lo], b[lo]}, eq));
+        } else {
+            size_t mid = lo + (hi - lo) / 2;
+            std::string upper = equal(mid, hi);
+            circuit.addGate(Gate(Gate::Type::AND, {upper, equal(lo, mid)}, eq));
+        }
+        return equalities.emplace(std::make_pair(lo, hi), eq).first->second;
+    }
+
+private:
+    LogicCircuit& circuit;
+    const std::vector<std::string>& a;
+    const std::vector<std::string>& b;
+    std::map<std::pair<size_t, size_t>, std::string> equalities;
+};
+
+// Bits of a shifted operand, built on demand from the result bits backwards, so only
+// MUXes some result bit depends on are created. Stage 0 is the extended operand, stage
+// j + 1 is stage j shifted by 2^j when amount bit j is set.
+class BarrelShifter {
+public:
+    BarrelShifter(LogicCircuit& circuit, const std::vector<std::string>& a, const std::vector<std::string>& amount,
+                  ArithmeticBuilder::ShiftKind kind, size_t width, size_t stages)
+        : circuit(circuit), a(a), amount(amount), left(kind == ArithmeticBuilder::ShiftKind::LEFT),
+          width(width), built(stages + 1, std::vector<std::string>(width)) {}
+
+    // Position i of the operand zero-extended to `width`; outside it, the 0s shifted in
+    const std::string& source(long i) const {
+        if (i < 0 || static_cast<size_t>(i) >= a.size()) return LogicCircuit::kConst0;
+        return a[i];
+    }
+
+    const std::string& bit(size_t stage, long i) {
+        if (stage == 0 || i < 0 || static_cast<size_t>(i) >= width) return source(i);
+        std::string& cached = built[stage][i];
+        if (!cached.empty()) return cached;
+        long step = 1L << (stage - 1);
+        std::string kept = bit(stage - 1, i);
+        std::string moved = bit(stage - 1, left ? i - step : i + step);
+        if (kept == moved) {
+            cached = kept;
+        } else {
+            cached = circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::MUX, {kept, moved, amount[stage - 1]}, cached));
+        }
+        return cached;
+    }
+
+private:
+    LogicCircuit& circuit;
+    const std::vector<std::string>& a;
+    const std::vector<std::string>& amount;
+    bool left;
+    size_t width;
+    std::vector<std::vector<std::string>> built;
+};
+
+} // namespace
+
+bool ArithmeticBuilder::parseArchitecture(const std::string& name, AdderArchitecture& arch) {
+    static const AdderArchitecture all[] = {AdderArchitecture::RIPPLE, AdderArchitecture::CARRY_LOOKAHEAD,
+                                            AdderArchitecture::KOGGE_STONE, AdderArchitecture::BRENT_KUNG,
+                                            AdderArchitecture::SKLANSKY};
+    for (AdderArchitecture candidate : all) {
+        if (name == architectureName(candidate)) {
+            arch = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ArithmeticBuilder::parseArchitecture(const std::string& name, MultiplierArchitecture& arch) {
+    for (MultiplierArchitecture candidate : {MultiplierArchitecture::WALLACE, MultiplierArchitecture::DADDA}) {
+        if (name == architectureName(candidate)) {
+            arch = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* ArithmeticBuilder::architectureName(AdderArchitecture arch) {
+    switch (arch) {
+        case AdderArchitecture::RIPPLE:          return "ripple";
+        case AdderArchitecture::CARRY_LOOKAHEAD: return "cla";
+        case AdderArchitecture::KOGGE_STONE:     return "kogge-stone";
+        case AdderArchitecture::BRENT_KUNG:      return "brent-kung";
+        case AdderArchitecture::SKLANSKY:        return "sklansky";
+    }
+    return "?";
+}
+
+const char* ArithmeticBuilder::architectureName(MultiplierArchitecture arch) {
+    switch (arch) {
+        case MultiplierArchitecture::WALLACE: return "wallace";
+        case MultiplierArchitecture::DADDA:   return "dadda";
+    }
+    return "?";
+}
+
+void ArithmeticBuilder::fullAdder(LogicCircuit& circuit, const std::string& a, const std::string& b,
+                                  const std::string& c, const std::string& sum, const std::string& carry) {
+    circuit.addGate(Gate(Gate::Type::XOR, {a, b, c}, sum));
+    if (!carry.empty()) circuit.addGate(Gate(Gate::Type::MAJ, {a, b, c}, carry));
+}
+
+void ArithmeticBuilder::halfAdder(LogicCircuit& circuit, const std::string& a, const std::string& b,
+                                  const std::string& sum, const std::string& carry) {
+    circuit.addGate(Gate(Gate::Type::XOR, {a, b}, sum));
+    if (!carry.empty()) circuit.addGate(Gate(Gate::Type::AND, {a, b}, carry));
+}
+
+void ArithmeticBuilder::add(LogicCircuit& circuit, const std::vector<std::string>& a,
+                            const std::vector<std::string>& b, bool carryIn, const std::vector<std::string>& sum,
+                            AdderArchitecture arch) {
+    if (sum.empty()) return;
+    if (a.size() != sum.size() || b.size() != sum.size()) {
+        throw std::runtime_error("Vector width mismatch in addition");
+    }
+    switch (arch) {
+        case AdderArchitecture::RIPPLE:          addRipple(circuit, a, b, carryIn, sum); break;
+        case AdderArchitecture::CARRY_LOOKAHEAD: addLookahead(circuit, a, b, carryIn, sum); break;
+        default:                                 addPrefix(circuit, a, b, carryIn, sum, arch); break;
+    }
+}
+
+void ArithmeticBuilder::addRipple(LogicCircuit& circuit, const std::vector<std::string>& a,
+                                  const std::vector<std::string>& b, bool carryIn,
+                                  const std::vector<std::string>& sum) {
+    std::string carry;
+    for (size_t i = 0; i < sum.size(); i++) {
+        std::string carryOut = i + 1 < sum.size() ? circuit.newTemp() : "";
+        if (i > 0) {
+            fullAdder(circuit, a[i], b[i], carry, sum[i], carryOut);
+        } else if (carryIn) {
+            // a0 + b0 + 1: sum = ~(a0 ^ b0), carry = a0 | b0
+            circuit.addGate(Gate(Gate::Type::XNOR, {a[0], b[0]}, sum[0]));
+            if (!carryOut.empty()) circuit.addGate(Gate(Gate::Type::OR, {a[0], b[0]}, carryOut));
+        } else {
+            circuit.addGate(Gate(Gate::Type::XOR, {a[0], b[0]}, sum[0]));
+            if (!carryOut.empty()) circuit.addGate(Gate(Gate::Type::AND, {a[0], b[0]}, carryOut));
+        }
+        carry = carryOut;
+    }
+}
+
+void ArithmeticBuilder::addLookahead(LogicCircuit& circuit, const std::vector<std::string>& a,
+                                     const std::vector<std::string>& b, bool carryIn,
+                                     const std::vector<std::string>& sum) {
+    const size_t kBlock = 4;
+    size_t n = sum.size();
+    CarryNetwork net(circuit, a, b, carryIn);
+    std::vector<std::string> carries(n);
+
+    // Inside a block every carry is a flat sum of products over the block's g/p and the
+    // block carry-in: c[i+1] = g[i] | p[i] g[i-1] | ... | p[i]..p[k] c[k]
+    for (size_t k = 0; k + 1 < n; k += kBlock) {
+        for (size_t i = k; i < std::min(k + kBlock, n - 1); i++) {
+            std::vector<std::string> terms;
+            for (size_t j = k; j <= i + (k > 0 ? 1 : 0); j++) {
+                // j == i + 1 stands for the block carry-in term
+                bool blockIn = j == i + 1;
+                std::vector<std::string> product;
+                for (size_t t = blockIn ? k : j + 1; t <= i; t++) product.push_back(net.propagate(static_cast<int>(t)));
+                product.push_back(blockIn ? carries[k] : net.generate(static_cast<int>(j)));
+                if (product.size() == 1) {
+                    terms.push_back(product[0]);
+                } else {
+                    terms.push_back(circuit.newTemp());
+                    circuit.addGate(Gate(Gate::Type::AND, product, terms.back()));
+                }
+            }
+            if (terms.size() == 1) {
+                carries[i + 1] = terms[0];
+            } else {
+                carries[i + 1] = circuit.newTemp();
+                circuit.addGate(Gate(Gate::Type::OR, terms, carries[i + 1]));
+            }
+        }
+    }
+    net.sums(carries, sum);
+}
+
+void ArithmeticBuilder::addPrefix(LogicCircuit& circuit, const std::vector<std::string>& a,
+                                  const std::vector<std::string>& b, bool carryIn,
+                                  const std::vector<std::string>& sum, AdderArchitecture arch) {
+    size_t n = sum.size();
+    CarryNetwork net(circuit, a, b, carryIn);
+    // cur[i] is the cell covering bits [lo, i]; every network ends with lo = 0 everywhere
+    std::vector<int> cur(n);
+    for (size_t i = 0; i < n; i++) cur[i] = static_cast<int>(i);
+
+    size_t top = 1;
+    while (top * 2 < n) top *= 2;
+    switch (arch) {
+        case AdderArchitecture::KOGGE_STONE:
+            for (size_t d = 1; d < n; d *= 2) {
+                std::vector<int> next = cur;
+                for (size_t i = d; i < n; i++) next[i] = net.combine(cur[i], cur[i - d]);
+                cur = next;
+            }
+            break;
+        case AdderArchitecture::SKLANSKY:
+            for (size_t d = 1; d < n; d *= 2) {
+                for (size_t i = 0; i < n; i++) {
+                    if (i & d) cur[i] = net.combine(cur[i], cur[(i & ~(2 * d - 1)) + d - 1]);
+                }
+            }
+            break;
+        default:  // BRENT_KUNG: up-sweep to power-of-two positions, then fill in between
+            for (size_t d = 1; d < n; d *= 2) {
+                for (size_t i = 2 * d - 1; i < n; i += 2 * d) cur[i] = net.combine(cur[i], cur[i - d]);
+            }
+            for (size_t d = top / 2; d >= 1; d /= 2) {
+                for (size_t i = 3 * d - 1; i < n; i += 2 * d) cur[i] = net.combine(cur[i], cur[i - d]);
+            }
+            break;
+    }
+
+    // Cells are built on demand: only the carries into bits 1..n-1 are requested
+    std::vector<std::string> carries(n);
+    for (size_t i = 1; i < n; i++) carries[i] = net.generate(cur[i - 1]);
+    net.sums(carries, sum);
+}
+
+void ArithmeticBuilder::multiply(LogicCircuit& circuit, const std::vector<std::string>& a,
+                                 const std::vector<std::string>& b, const std::vector<std::string>& product,
+                                 MultiplierArchitecture arch, bool canonicalOrder, AdderArchitecture finalAdder) {
+    size_t width = product.size();
+    if (width == 0) return;
+    if (a.empty() || b.empty()) throw std::runtime_error("Empty operand in multiplication");
+
+    // Column k holds the bits of weight 2^k; weights beyond the product are never built
+    std::vector<std::vector<std::string>> columns(width);
+    std::vector<std::vector<std::pair<std::string, std::string>>> keyed(width);
+    for (size_t i = 0; i < b.size() && i < width; i++) {
+        for (size_t j = 0; j < a.size() && i + j < width; j++) {
+            std::string pp = circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::AND, {a[j], b[i]}, pp));
+            keyed[i + j].push_back({std::min(a[j], b[i]) + "," + std::max(a[j], b[i]), pp});
+        }
+    }
+    for (size_t k = 0; k < width; k++) {
+        if (canonicalOrder) std::sort(keyed[k].begin(), keyed[k].end());
+        for (const auto& entry : keyed[k]) columns[k].push_back(entry.second);
+    }
+
+    // One reduction stage: every column is cut down to at most `limit` bits, counting the
+    // carries it receives from the column below in the same stage. Wallace ignores the
+    // limit and compresses every triple and leftover pair.
+    auto stage = [&](size_t limit) {
+        std::vector<std::vector<std::string>> next(width);
+        for (size_t k = 0; k < width; k++) {
+            const std::vector<std::string>& column = columns[k];
+            size_t i = 0;
+            while (column.size() - i >= 2) {
+                size_t height = column.size() - i + next[k].size();
+                bool full = column.size() - i >= 3;
+                if (arch == MultiplierArchitecture::DADDA) {
+                    if (height <= limit) break;
+                    full = full && height - limit >= 2;
+                }
+                std::string sum = circuit.newTemp();
+                std::string carry = k + 1 < width ? circuit.newTemp() : "";
+                if (full) {
+                    fullAdder(circuit, column[i], column[i + 1], column[i + 2], sum, carry);
+                    i += 3;
+                } else {
+                    halfAdder(circuit, column[i], column[i + 1], sum, carry);
+                    i += 2;
+                }
+                next[k].push_back(sum);
+                if (!carry.empty()) next[k + 1].push_back(carry);
+            }
+            next[k].insert(next[k].end(), column.begin() + i, column.end());
+        }
+        columns.swap(next);
+    };
+
+    auto maxHeight = [&]() {
+        size_t height = 0;
+        for (const auto& column : columns) height = std::max(height, column.size());
+        return height;
+    };
+    if (arch == MultiplierArchitecture::DADDA) {
+        // Height targets 2, 3, 4, 6, 9, 13, ...: each stage reaches the next lower one
+        std::vector<size_t> limits = {2};
+        while (limits.back() < maxHeight()) limits.push_back(limits.back() * 3 / 2);
+        limits.pop_back();
+        for (size_t s = limits.size(); s-- > 0;) stage(limits[s]);
+    }
+    while (maxHeight() > 2) stage(2);
+
+    // Two rows left: bits below the first two-bit column are final, the rest go through the adder
+    size_t first = 0;
+    while (first < width && columns[first].size() < 2) {
+        const std::string& bit = columns[first].empty() ? LogicCircuit::kConst0 : columns[first][0];
+        circuit.addGate(Gate(Gate::Type::BUF, {bit}, product[first]));
+        first++;
+    }
+    if (first == width) return;
+    std::vector<std::string> x, y, sum(product.begin() + first, product.end());
+    for (size_t k = first; k < width; k++) {
+        x.push_back(columns[k].size() > 0 ? columns[k][0] : LogicCircuit::kConst0);
+        y.push_back(columns[k].size() > 1 ? columns[k][1] : LogicCircuit::kConst0);
+    }
+    add(circuit, x, y, false, sum, finalAdder);
+}
+
+void ArithmeticBuilder::compare(LogicCircuit& circuit, std::vector<std::string> a, std::vector<std::string> b,
+                                Comparison op, const std::string& result, bool direct) {
+    if (a.empty() || b.empty()) throw std::runtime_error("Empty operand in comparison");
+    size_t n = std::max(a.size(), b.size());
+    a.resize(n, LogicCircuit::kConst0);
+    b.resize(n, LogicCircuit::kConst0);
+
+    if (op == Comparison::EQ || op == Comparison::NE) {
+        bool equal = op == Comparison::EQ;
+        if (direct) {
+            std::vector<std::string> pairs;
+            for (size_t i = 0; i < n; i++) {
+                pairs.push_back(a[i]);
+                pairs.push_back(b[i]);
+            }
+            std::string eq = equal ? result : circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::EQ, pairs, eq));
+            if (!equal) circuit.addGate(Gate(Gate::Type::NOT, {eq}, result));
+        } else if (n == 1) {
+            circuit.addGate(Gate(equal ? Gate::Type::XNOR : Gate::Type::XOR, {a[0], b[0]}, result));
+        } else {
+            std::vector<std::string> same(n);
+            for (size_t i = 0; i < n; i++) {
+                same[i] = circuit.newTemp();
+                circuit.addGate(Gate(Gate::Type::XNOR, {a[i], b[i]}, same[i]));
+            }
+            circuit.addGate(Gate(equal ? Gate::Type::AND : Gate::Type::NAND, same, result));
+        }
+        return;
+    }
+
+    // a > b is b < a; a >= b and a <= b are the complements of a < b and b < a
+    if (op == Comparison::GT || op == Comparison::LE) std::swap(a, b);
+    bool strict = op == Comparison::LT || op == Comparison::GT;
+    std::string less = strict ? result : circuit.newTemp();
+    MagnitudeTree(circuit, a, b).less(0, n, less);
+    if (!strict) circuit.addGate(Gate(Gate::Type::NOT, {less}, result));
+}
+
+void ArithmeticBuilder::shift(LogicCircuit& circuit, const std::vector<std::string>& a, uint64_t amount,
+                              ShiftKind kind, const std::vector<std::string>& result) {
+    if (a.empty()) throw std::runtime_error("Empty operand in shift");
+    size_t width = std::max(a.size(), result.size());
+    for (size_t i = 0; i < result.size(); i++) {
+        // Bit i of the extended operand shifted by `amount`, or a vacated position
+        const std::string* bit = &LogicCircuit::kConst0;
+        if (kind == ShiftKind::LEFT) {
+            if (i >= amount) bit = i - amount < a.size() ? &a[i - amount] : &LogicCircuit::kConst0;
+        } else {
+            if (amount < width - i && i + amount < a.size()) bit = &a[i + amount];
+        }
+        circuit.addGate(Gate(Gate::Type::BUF, {*bit}, result[i]));
+    }
+}
+
+void ArithmeticBuilder::shift(LogicCircuit& circuit, const std::vector<std::string>& a,
+                              const std::vector<std::string>& amount, ShiftKind kind,
+                              const std::vector<std::string>& result) {
+    if (a.empty() || amount.empty()) throw std::runtime_error("Empty operand in shift");
+    size_t width = std::max(a.size(), result.size());
+    size_t stages = 0;
+    while (stages < amount.size() && (size_t(1) << stages) < width) stages++;
+    BarrelShifter shifter(circuit, a, amount, kind, width, stages);
+
+    // Amount bits of weight >= width shift everything out
+    std::vector<std::string> high(amount.begin() + stages, amount.end());
+    std::string overflow;
+    if (high.size() == 1) {
+        overflow = high[0];
+    } else if (high.size() > 1) {
+        overflow = circuit.newTemp();
+        circuit.addGate(Gate(Gate::Type::OR, high, overflow));
+    }
+    for (size_t i = 0; i < result.size(); i++) {
+        const std::string& shifted = shifter.bit(stages, static_cast<long>(i));
+        if (overflow.empty() || shifted == LogicCircuit::kConst0) {
+            circuit.addGate(Gate(Gate::Type::BUF, {shifted}, result[i]));
+        } else {
+            circuit.addGate(Gate(Gate::Type::MUX, {shifted, LogicCircuit::kConst0, overflow}, result[i]));
+        }
+    }
+}
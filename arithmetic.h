@@ -0,0 +1,68 @@
+#ifndef ARITHMETIC_H
+#define ARITHMETIC_H
+
+#include "ver2cnf.h"
+
+// ---------------- ArithmeticBuilder ----------------
+// Gate-level datapath generators used by the parser. Bit vectors are LSB first; every
+// builder creates only the gates its outputs need, so no dangling signals show up as
+// extra circuit outputs.
+class ArithmeticBuilder {
+public:
+    enum class Comparison { EQ, NE, LT, LE, GT, GE };
+    // Vacated bits are filled with 0 (without signed types, >>> is a logical shift too)
+    enum class ShiftKind { LEFT, RIGHT };
+
+    static bool parseArchitecture(const std::string& name, AdderArchitecture& arch);
+    static bool parseArchitecture(const std::string& name, MultiplierArchitecture& arch);
+    static const char* architectureName(AdderArchitecture arch);
+    static const char* architectureName(MultiplierArchitecture arch);
+
+    // sum = a + b (+ 1 when carryIn is set), modulo 2^width. All vectors have the width of sum.
+    static void add(LogicCircuit& circuit, const std::vector<std::string>& a, const std::vector<std::string>& b,
+                    bool carryIn, const std::vector<std::string>& sum, AdderArchitecture arch);
+
+    // sum = a ^ b ^ c and carry = MAJ(a, b, c): two CNF variables and 14 clauses (8 for
+    // the 3-input XOR, 6 for the majority), no intermediate signals. An empty `carry`
+    // skips the carry gate.
+    static void fullAdder(LogicCircuit& circuit, const std::string& a, const std::string& b, const std::string& c,
+                          const std::string& sum, const std::string& carry);
+    // sum = a ^ b, carry = a & b (7 clauses)
+    static void halfAdder(LogicCircuit& circuit, const std::string& a, const std::string& b,
+                          const std::string& sum, const std::string& carry);
+
+    // product = a * b modulo 2^width(product): AND partial products, Wallace or Dadda
+    // reduction of each column to two bits with full and half adders, then `finalAdder`.
+    // With canonicalOrder, every column is sorted by the operand names of its partial products.
+    static void multiply(LogicCircuit& circuit, const std::vector<std::string>& a, const std::vector<std::string>& b,
+                         const std::vector<std::string>& product, MultiplierArchitecture arch, bool canonicalOrder,
+                         AdderArchitecture finalAdder);
+
+    // result = a <op> b, unsigned; the shorter operand is zero-extended. Equality is one
+    // n-ary AND of XNORs (NAND for !=), or a single EQ gate when `direct` is set. Magnitude
+    // is a balanced tree, log2(n) MUX levels: a[hi:lo] < b[hi:lo] selects the lower half's
+    // result when the upper halves are equal and the upper half's otherwise.
+    static void compare(LogicCircuit& circuit, std::vector<std::string> a, std::vector<std::string> b,
+                        Comparison op, const std::string& result, bool direct);
+
+    // result = a shifted by `amount`. The operand is first zero-extended to the width of
+    // result. A constant shift is pure rewiring: BUFs only,
+    // which the CNF folds into literals, so no gate variable is created.
+    static void shift(LogicCircuit& circuit, const std::vector<std::string>& a, uint64_t amount, ShiftKind kind,
+                      const std::vector<std::string>& result);
+    // Barrel shifter: amount bit j < log2(width) selects a shift by 2^j in one MUX layer;
+    // any higher amount bit set forces every result bit to 0
+    static void shift(LogicCircuit& circuit, const std::vector<std::string>& a,
+                      const std::vector<std::string>& amount, ShiftKind kind, const std::vector<std::string>& result);
+
+private:
+    static void addRipple(LogicCircuit& circuit, const std::vector<std::string>& a,
+                          const std::vector<std::string>& b, bool carryIn, const std::vector<std::string>& sum);
+    static void addLookahead(LogicCircuit& circuit, const std::vector<std::string>& a,
+                             const std::vector<std::string>& b, bool carryIn, const std::vector<std::string>& sum);
+    static void addPrefix(LogicCircuit& circuit, const std::vector<std::string>& a,
+                          const std::vector<std::string>& b, bool carryIn, const std::vector<std::string>& sum,
+                          AdderArchitecture arch);
+};
+
+#endif // ARITHMETIC_H
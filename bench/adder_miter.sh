@@ -0,0 +1,47 @@
+#!/bin/sh
+# Adder-equivalence miters: a gate-level ripple-carry reference against `a + b` built
+# with each adder architecture. Prints CNF size and solver time per width/architecture.
+#
+#   bench/adder_miter.sh [widths...]        (default: 16 32 64)
+#   SAT=kissat bench/adder_miter.sh 128     (any DIMACS solver, default minisat)
+set -e
+cd "$(dirname "$0")/.."
+SAT=${SAT:-minisat}
+WIDTHS=${*:-"16 32 64"}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+make -s equiv_checker
+
+printf "%-6s %-12s %9s %9s %9s  %s\n" width adder vars clauses seconds result
+for w in $WIDTHS; do
+    msb=$((w - 1))
+    # Reference: explicit per-bit sum and carry assignments
+    {
+        echo "module ref_add(a, b, s);"
+        echo "input [$msb:0] a;"
+        echo "input [$msb:0] b;"
+        echo "output [$msb:0] s;"
+        echo "assign s[0] = a[0] ^ b[0];"
+        echo "assign c1 = a[0] & b[0];"
+        i=1
+        while [ $i -lt $w ]; do
+            echo "assign s[$i] = a[$i] ^ b[$i] ^ c$i;"
+            [ $i -lt $msb ] && echo "assign c$((i + 1)) = (a[$i] & b[$i]) | (c$i & (a[$i] ^ b[$i]));"
+            i=$((i + 1))
+        done
+        echo "endmodule"
+    } > "$WORK/ref.v"
+    printf "module add(a, b, s);\ninput [%d:0] a;\ninput [%d:0] b;\noutput [%d:0] s;\nassign s = a + b;\nendmodule\n" \
+        $msb $msb $msb > "$WORK/add.v"
+
+    for arch in ripple cla kogge-stone brent-kung sklansky; do
+        ./equiv_checker "$WORK/ref.v" "$WORK/add.v" --adder $arch > /dev/null
+        header=$(grep '^p cnf' equivalence.cnf)
+        start=$(date +%s.%N)
+        result=$($SAT equivalence.cnf 2>/dev/null | grep -E -o 'UNSATISFIABLE|SATISFIABLE' | head -1) || true
+        end=$(date +%s.%N)
+        printf "%-6s %-12s %9s %9s %9.3f  %s\n" $w $arch $(echo "$header" | cut -d' ' -f3,4) \
+            $(awk "BEGIN { print $end - $start }") "${result:-?}"
+    done
+done
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Multiplier-equivalence miters: `a * b` against `b * a`, with the partial products in
+# row order and in canonical order. Prints CNF size and solver time per width/order;
+# a solver still running after $TIMEOUT seconds is reported as a timeout.
+#
+#   bench/multiplier_miter.sh [widths...]             (default: 6 8 10)
+#   SAT=kissat TIMEOUT=600 bench/multiplier_miter.sh 16
+set -e
+cd "$(dirname "$0")/.."
+SAT=${SAT:-minisat}
+TIMEOUT=${TIMEOUT:-60}
+WIDTHS=${*:-"6 8 10"}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+make -s equiv_checker
+
+printf "%-6s %-10s %9s %9s %9s  %s\n" width order vars clauses seconds result
+for w in $WIDTHS; do
+    msb=$((w - 1))
+    for pair in ab ba; do
+        x=$(echo $pair | cut -c1)
+        y=$(echo $pair | cut -c2)
+        printf "module mul(a, b, p);\ninput [%d:0] a;\ninput [%d:0] b;\noutput [%d:0] p;\nassign p = %s * %s;\nendmodule\n" \
+            $msb $msb $((2 * w - 1)) $x $y > "$WORK/$pair.v"
+    done
+
+    for order in row canonical; do
+        ./equiv_checker "$WORK/ab.v" "$WORK/ba.v" --pp-order $order > /dev/null
+        header=$(grep '^p cnf' equivalence.cnf)
+        start=$(date +%s.%N)
+        result=$(timeout $TIMEOUT $SAT equivalence.cnf 2>/dev/null | grep -E -o 'UNSATISFIABLE|SATISFIABLE' | head -1) || true
+        end=$(date +%s.%N)
+        printf "%-6s %-10s %9s %9s %9.3f  %s\n" $w $order $(echo "$header" | cut -d' ' -f3,4) \
+            $(awk "BEGIN { print $end - $start }") "${result:-timeout}"
+    done
+done
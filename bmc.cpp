@@ -0,0 +1,68 @@
+#include "bmc.h"
+#include <cstdlib>
+
+// ---------------- Unroller ----------------
+Unroller::Unroller(const LogicCircuit& circuit, const std::vector<std::string>& roots, size_t xorCut) {
+    std::vector<std::string> cones = roots;
+    for (const auto& latch : circuit.latches) cones.push_back(latch.second);
+    CNFConverter converter;
+    converter.setXorCut(xorCut);
+    ClauseList cnf = converter.circuitToCNF(circuit, cones);
+    templateMap = converter.getVariableMap();
+    int variables = converter.getNumVariables();
+
+    // A latch output read in the frame is an undriven signal, so a variable of its own
+    stateIndex.assign(variables + 1, -1);
+    for (const auto& latch : circuit.latches) {
+        auto current = templateMap.find(latch.first);
+        if (current == templateMap.end() || current->second <= 0 || stateIndex[current->second] >= 0) continue;
+        stateIndex[current->second] = static_cast<int>(states.size());
+        states.push_back({current->second, templateMap.at(latch.second)});
+    }
+    frameIndex.assign(variables + 1, 0);
+    for (int v = 1; v <= variables; v++) {
+        if (stateIndex[v] < 0) frameIndex[v] = static_cast<int>(++frameWidth);
+    }
+
+    for (const auto& clause : cnf) {
+        clauses.insert(clauses.end(), clause.begin(), clause.end());
+        clauses.push_back(0);
+    }
+    clauseCount = cnf.size();
+}
+
+int Unroller::mapLiteral(int lit, size_t t) const {
+    int v = std::abs(lit);
+    int mapped = stateIndex[v] >= 0 ? stateLiterals[t][stateIndex[v]]
+                                    : static_cast<int>(states.size() + t * frameWidth) + frameIndex[v];
+    return lit < 0 ? -mapped : mapped;
+}
+
+const std::vector<int>& Unroller::nextFrame() {
+    size_t t = stateLiterals.size();
+    // Frame 0 reads the initial-state variables, frame t the next states of frame t - 1
+    std::vector<int> current(states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+        current[i] = t == 0 ? static_cast<int>(i + 1) : mapLiteral(states[i].next, t - 1);
+    }
+    stateLiterals.push_back(std::move(current));
+
+    frame.resize(clauses.size());
+    for (size_t i = 0; i < clauses.size(); i++) frame[i] = clauses[i] == 0 ? 0 : mapLiteral(clauses[i], t);
+    return frame;
+}
+
+std::vector<int> Unroller::zeroInitialState() const {
+    std::vector<int> units;
+    for (size_t i = 0; i < states.size(); i++) {
+        units.push_back(-static_cast<int>(i + 1));
+        units.push_back(0);
+    }
+    return units;
+}
+
+int Unroller::literal(const std::string& signal, size_t frame) const {
+    if (frame >= stateLiterals.size()) throw std::runtime_error("Frame " + std::to_string(frame) + " not unrolled yet");
+    auto lit = templateMap.find(signal);
+    return lit == templateMap.end() ? 0 : mapLiteral(lit->second, frame);
+}
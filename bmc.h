@@ -0,0 +1,50 @@
+#ifndef BMC_H
+#define BMC_H
+
+#include "ver2cnf.h"
+
+// ---------------- Unroller ----------------
+// Bounded model checking over the latches of clocked always blocks. One frame of the
+// transition relation (the cones of `roots` and of every next-state signal) is encoded
+// once into a CNF template. Frame t is that template with its variables shifted by t
+// frame widths and its latch outputs replaced by the next-state literals of frame t - 1,
+// so k frames cost k passes over an int array: no gates, no signal names, no extra
+// variables or clauses for the frame links.
+class Unroller {
+public:
+    Unroller(const LogicCircuit& circuit, const std::vector<std::string>& roots, size_t xorCut = 3);
+
+    // Clauses of the next frame (frame `frames()` before the call), DIMACS style: the
+    // literals of each clause followed by a 0. Valid until the next call.
+    const std::vector<int>& nextFrame();
+    size_t frames() const { return stateLiterals.size(); }
+
+    // Unit clauses setting every latch to 0 in frame 0; without them the initial state is free
+    std::vector<int> zeroInitialState() const;
+    // Literal of `signal` in an emitted frame, 0 when the signal is outside the encoded cones
+    int literal(const std::string& signal, size_t frame) const;
+
+    size_t latchCount() const { return states.size(); }
+    size_t clausesPerFrame() const { return clauseCount; }
+    // Variables of `count` frames: the initial state, then the frame variables of each frame
+    int numVariables(size_t count) const { return static_cast<int>(states.size() + count * frameWidth); }
+
+private:
+    struct State {
+        int current;  // template variable of the latch output
+        int next;     // template literal of its next state
+    };
+    std::vector<int> clauses;                    // template, 0-terminated clauses
+    size_t clauseCount = 0;
+    std::unordered_map<std::string, int> templateMap;
+    std::vector<State> states;
+    std::vector<int> stateIndex;                 // template variable -> index in states, -1 if none
+    std::vector<int> frameIndex;                 // template variable -> 1-based index within a frame
+    size_t frameWidth = 0;                       // template variables that are not latch outputs
+    std::vector<std::vector<int>> stateLiterals;  // per emitted frame, the literal of every latch output
+    std::vector<int> frame;
+
+    int mapLiteral(int lit, size_t t) const;
+};
+
+#endif // BMC_H
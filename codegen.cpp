@@ -0,0 +1,200 @@
+#include "codegen.h"
+
+// ---------------- SimulationCodeGenerator ----------------
+namespace {
+
+// Value ids: -1 is constant 0 (any undriven signal), -2 constant 1, [0, numInputs) are
+// primary inputs, numInputs + k is statement k
+struct CodegenStmt {
+    Gate::Type type;
+    std::vector<int> fanin;
+    std::string name;
+    size_t group;
+    int shared;
+};
+
+std::string cString(const std::string& s) {
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+} // namespace
+
+SimulationCodeGenerator::Stats SimulationCodeGenerator::emit(const LogicCircuit& circuit, std::ostream& out,
+                                                             size_t statementsPerFunction) {
+    // ---- Ports, in the same order as LogicSimulator ----
+    std::vector<std::string> inputNames = circuit.getInputs();
+    std::vector<std::string> outputNames(circuit.outputs.begin(), circuit.outputs.end());
+    std::sort(outputNames.begin(), outputNames.end());
+    if (outputNames.empty()) outputNames = circuit.getOutputs();
+    int numInputs = static_cast<int>(inputNames.size());
+
+    std::unordered_map<std::string, int> valueOf;
+    for (int i = 0; i < numInputs; i++) valueOf[inputNames[i]] = i;
+
+    auto valueId = [&](const std::string& name) {
+        auto v = valueOf.find(name);
+        if (v != valueOf.end()) return v->second;
+        // undriven and not an input: a constant
+        return valueOf[name] = name == LogicCircuit::kConst1 ? -2 : -1;
+    };
+
+    // ---- Cone order: the gates each output adds, drivers first; BUFs resolve to their source ----
+    std::vector<CodegenStmt> stmts;
+    std::vector<std::pair<int, size_t>> outputValues; // (value, group it is written in)
+    size_t group = 0, groupSize = 0;
+    std::vector<char> done;
+    for (const auto& root : outputNames) {
+        for (size_t g : circuit.cone({root}, &done).gates) {
+            const Gate& gate = circuit.gates[g];
+            const std::string& name = gate.output;
+            // an input keeps its stimulus value
+            if (valueOf.find(name) != valueOf.end()) continue;
+
+            if (gate.inputs.empty()) {
+                throw std::runtime_error("Gate driving " + name + " has no inputs");
+            }
+            if ((gate.type == Gate::Type::MUX || gate.type == Gate::Type::MAJ) && gate.inputs.size() != 3) {
+                throw std::runtime_error((gate.type == Gate::Type::MUX ? "MUX driving " : "MAJ driving ") + name +
+                                         " needs 3 inputs");
+            }
+            if (gate.type == Gate::Type::EQ && gate.inputs.size() % 2 != 0) {
+                throw std::runtime_error("EQ driving " + name + " needs input pairs");
+            }
+            std::vector<int> fanin;
+            for (const auto& in : gate.inputs) fanin.push_back(valueId(in));
+
+            bool alias = gate.type == Gate::Type::BUF ||
+                         (fanin.size() == 1 && (gate.type == Gate::Type::AND || gate.type == Gate::Type::OR ||
+                                                gate.type == Gate::Type::XOR));
+            if (alias) {
+                valueOf[name] = fanin[0];
+                continue;
+            }
+
+            if (groupSize >= statementsPerFunction) {
+                group++;
+                groupSize = 0;
+            }
+            valueOf[name] = numInputs + static_cast<int>(stmts.size());
+            stmts.push_back({gate.type, fanin, name, group, -1});
+            groupSize++;
+        }
+        outputValues.push_back({valueId(root), group});
+    }
+    size_t numGroups = group + 1;
+
+    // ---- Values used outside the group that computes them go through the shared array ----
+    Stats stats;
+    auto markUse = [&](int value, size_t useGroup) {
+        if (value < numInputs) return;
+        CodegenStmt& def = stmts[value - numInputs];
+        if (def.group != useGroup && def.shared < 0) def.shared = static_cast<int>(stats.sharedSignals++);
+    };
+    for (const auto& stmt : stmts) {
+        for (int f : stmt.fanin) markUse(f, stmt.group);
+    }
+    for (const auto& ov : outputValues) markUse(ov.first, ov.second);
+
+    // ---- Emit ----
+    auto ref = [&](int value, size_t useGroup) -> std::string {
+        if (value < 0) return value == -2 ? "~UINT64_C(0)" : "UINT64_C(0)";
+        if (value < numInputs) return "i" + std::to_string(value);
+        const CodegenStmt& def = stmts[value - numInputs];
+        if (def.group != useGroup) return "s[" + std::to_string(def.shared) + "]";
+        return "t" + std::to_string(value - numInputs);
+    };
+
+    out << "// Generated by sat_cnf from module " << circuit.name << ": straight-line bit-parallel simulation.\n";
+    out << "// Pattern p of port k is bit (p % 64) of word k * words + p / 64.\n";
+    out << "#include <stddef.h>\n#include <stdint.h>\n\n";
+    out << "static const char* const kInputNames[] = {";
+    for (const auto& name : inputNames) out << cString(name) << ", ";
+    out << "0};\nstatic const char* const kOutputNames[] = {";
+    for (const auto& name : outputNames) out << cString(name) << ", ";
+    out << "0};\n\n";
+
+    size_t next = 0;
+    for (size_t g = 0; g < numGroups; g++) {
+        out << "static void group_" << g
+            << "(const uint64_t* in, size_t words, size_t w, uint64_t* s, uint64_t* out) {\n";
+        out << "    (void)in; (void)words; (void)w; (void)s; (void)out;\n";
+
+        // inputs read by this group
+        std::vector<bool> loaded(inputNames.size(), false);
+        size_t first = next;
+        while (next < stmts.size() && stmts[next].group == g) next++;
+        for (size_t k = first; k < next; k++) {
+            for (int f : stmts[k].fanin) {
+                if (f >= 0 && f < numInputs) loaded[f] = true;
+            }
+        }
+        for (size_t o = 0; o < outputValues.size(); o++) {
+            int v = outputValues[o].first;
+            if (outputValues[o].second == g && v >= 0 && v < numInputs) loaded[v] = true;
+        }
+        for (int i = 0; i < numInputs; i++) {
+            if (loaded[i]) out << "    const uint64_t i" << i << " = in[" << i << " * words + w];\n";
+        }
+
+        for (size_t k = first; k < next; k++) {
+            const CodegenStmt& stmt = stmts[k];
+            std::vector<std::string> a;
+            for (int f : stmt.fanin) a.push_back(ref(f, g));
+            auto join = [&a](const char* op) {
+                std::string e = a[0];
+                for (size_t j = 1; j < a.size(); j++) e += std::string(" ") + op + " " + a[j];
+                return e;
+            };
+            std::string expr;
+            switch (stmt.type) {
+                case Gate::Type::NOT:  expr = "~" + a[0]; break;
+                case Gate::Type::AND:  expr = join("&"); break;
+                case Gate::Type::OR:   expr = join("|"); break;
+                case Gate::Type::XOR:  expr = join("^"); break;
+                case Gate::Type::NAND: expr = "~(" + join("&") + ")"; break;
+                case Gate::Type::NOR:  expr = "~(" + join("|") + ")"; break;
+                case Gate::Type::XNOR: expr = "~(" + join("^") + ")"; break;
+                case Gate::Type::MUX:  expr = "(" + a[0] + " & ~" + a[2] + ") | (" + a[1] + " & " + a[2] + ")"; break;
+                case Gate::Type::MAJ:  expr = "(" + a[0] + " & " + a[1] + ") | (" + a[2] + " & (" + a[0] + " | " + a[1] + "))"; break;
+                case Gate::Type::BUF:  expr = a[0]; break;
+                case Gate::Type::EQ:
+                    expr = "(" + a[0] + " ^ " + a[1] + ")";
+                    for (size_t j = 2; j + 1 < a.size(); j += 2) expr += " | (" + a[j] + " ^ " + a[j + 1] + ")";
+                    expr = "~(" + expr + ")";
+                    break;
+            }
+            out << "    const uint64_t t" << k << " = " << expr << "; // " << stmt.name << "\n";
+            if (stmt.shared >= 0) out << "    s[" << stmt.shared << "] = t" << k << ";\n";
+        }
+        for (size_t o = 0; o < outputValues.size(); o++) {
+            if (outputValues[o].second != g) continue;
+            out << "    out[" << o << " * words + w] = " << ref(outputValues[o].first, g) << "; // "
+                << outputNames[o] << "\n";
+        }
+        out << "}\n\n";
+    }
+
+    out << "extern \"C\" {\n\n";
+    out << "size_t circuit_sim_num_inputs(void) { return " << inputNames.size() << "; }\n";
+    out << "size_t circuit_sim_num_outputs(void) { return " << outputNames.size() << "; }\n";
+    out << "const char* circuit_sim_input_name(size_t i) { return i < " << inputNames.size()
+        << " ? kInputNames[i] : 0; }\n";
+    out << "const char* circuit_sim_output_name(size_t o) { return o < " << outputNames.size()
+        << " ? kOutputNames[o] : 0; }\n\n";
+    out << "void circuit_sim_eval(const uint64_t* in, uint64_t* out, size_t words) {\n";
+    out << "    static thread_local uint64_t s[" << std::max<size_t>(stats.sharedSignals, 1) << "];\n";
+    out << "    for (size_t w = 0; w < words; w++) {\n";
+    for (size_t g = 0; g < numGroups; g++) {
+        out << "        group_" << g << "(in, words, w, s, out);\n";
+    }
+    out << "    }\n}\n\n} // extern \"C\"\n";
+
+    stats.statements = stmts.size();
+    stats.functions = numGroups;
+    return stats;
+}
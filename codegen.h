@@ -0,0 +1,30 @@
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include "ver2cnf.h"
+
+// ---------------- SimulationCodeGenerator ----------------
+// Emits a self-contained C++ source that evaluates a LogicCircuit as straight-line
+// uint64_t bitwise code, 64 patterns per word. Outputs are grouped by cone into
+// functions of bounded size; a signal computed in one group and used by a later one is
+// passed through a small shared array, everything else stays in locals.
+//
+// C ABI of the generated file (ports in LogicSimulator order, sorted by name):
+//   size_t circuit_sim_num_inputs(void);
+//   size_t circuit_sim_num_outputs(void);
+//   const char* circuit_sim_input_name(size_t i);
+//   const char* circuit_sim_output_name(size_t o);
+//   void circuit_sim_eval(const uint64_t* in, uint64_t* out, size_t words);
+// with the same word layout as LogicSimulator::simulate (in[i * words + w]).
+class SimulationCodeGenerator {
+public:
+    struct Stats {
+        size_t statements = 0;
+        size_t functions = 0;
+        size_t sharedSignals = 0;
+    };
+
+    static Stats emit(const LogicCircuit& circuit, std::ostream& out, size_t statementsPerFunction = 2000);
+};
+
+#endif // CODEGEN_H
@@ -1,4 +1,6 @@
 #include "ver2cnf.h"
+#include "truth_table.h"
+#include "arithmetic.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -6,6 +8,10 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <cstdlib>
 
 class EquivalenceChecker {
 private:
@@ -69,12 +75,200 @@ private:
 
         std::string current = inputs[0];
         for (size_t i = 1; i < inputs.size(); i++) {
-            std::string tempName = (i == inputs.size() - 1) ? output : "equiv_or_temp_" + std::to_string(i);
+            std::string tempName = (i == inputs.size() - 1) ? output : circuit.newTemp();
             circuit.addGate(Gate(Gate::Type::OR, {current, inputs[i]}, tempName));
             current = tempName;
         }
     }
 
+    // ---- Outcome of building and encoding one miter ----
+    struct MiterResult {
+        enum class Status { EQUIVALENT, DIFFERENT, UNDECIDED };
+        Status status = Status::UNDECIDED;
+        size_t gatesBefore = 0;
+        size_t gatesAfter = 0;
+        size_t identicalOutputs = 0;
+        size_t tableDecidedOutputs = 0;
+        size_t comparedOutputs = 0;
+        std::string counterexample;
+        int variables = 0;
+        size_t clauses = 0;
+    };
+
+    // ---- Build the miter of two parsed circuits, hash it and write its CNF ----
+    static MiterResult writeMiterCNF(const LogicCircuit& circuit1, const LogicCircuit& circuit2,
+                                     const std::string& cnfPath) {
+        // ---- Check input/output compatibility ----
+        std::vector<std::string> inputs1(circuit1.inputs.begin(), circuit1.inputs.end());
+        std::vector<std::string> inputs2(circuit2.inputs.begin(), circuit2.inputs.end());
+        std::vector<std::string> outputs1(circuit1.outputs.begin(), circuit1.outputs.end());
+        std::vector<std::string> outputs2(circuit2.outputs.begin(), circuit2.outputs.end());
+
+        std::sort(inputs1.begin(), inputs1.end());
+        std::sort(inputs2.begin(), inputs2.end());
+        std::sort(outputs1.begin(), outputs1.end());
+        std::sort(outputs2.begin(), outputs2.end());
+
+        if (inputs1 != inputs2) {
+            throw std::runtime_error("Circuits have different inputs!");
+        }
+        if (outputs1 != outputs2) {
+            throw std::runtime_error("Circuits have different outputs!");
+        }
+        if (inputs1.empty() || outputs1.empty()) {
+            throw std::runtime_error("Circuits must have inputs and outputs!");
+        }
+
+        // ---- Decide small-support outputs exhaustively; only the rest go into the miter ----
+        MiterResult result;
+        result.comparedOutputs = outputs1.size();
+        TruthTableEngine tables1(circuit1), tables2(circuit2);
+        auto onlyPrimary = [&circuit1](const std::vector<std::string>& support) {
+            for (const auto& s : support) {
+                if (circuit1.inputs.find(s) == circuit1.inputs.end()) return false;
+            }
+            return true;
+        };
+        std::vector<std::string> miterOutputs;
+        for (const auto& out : outputs1) {
+            // undriven internal wires are free per copy in the miter, leave those cones to it
+            std::vector<std::string> support1, support2;
+            bool equal = false;
+            std::vector<std::pair<std::string, bool>> cex;
+            if (!tables1.getSupport(out, support1) || !tables2.getSupport(out, support2) ||
+                !onlyPrimary(support1) || !onlyPrimary(support2) ||
+                !TruthTableEngine::decideEquivalence(tables1, out, tables2, out, equal, cex)) {
+                miterOutputs.push_back(out);
+                continue;
+            }
+            result.tableDecidedOutputs++;
+            if (equal) continue;
+
+            result.status = MiterResult::Status::DIFFERENT;
+            result.counterexample = out + " differs at";
+            for (const auto& assignment : cex) {
+                result.counterexample += " " + assignment.first + "=" + (assignment.second ? "1" : "0");
+            }
+            break;
+        }
+
+        if (result.status == MiterResult::Status::DIFFERENT || miterOutputs.empty()) {
+            if (result.status != MiterResult::Status::DIFFERENT) result.status = MiterResult::Status::EQUIVALENT;
+            writeTrivialCNF(cnfPath, result);
+            return result;
+        }
+
+        // ---- Combine circuits with shared inputs but renamed internal signals ----
+        LogicCircuit combined;
+        std::unordered_set<std::string> primaryInputs = circuit1.inputs;
+        combined.inputs = primaryInputs;
+
+        LogicCircuit c1_renamed = renameCircuit(circuit1, "_c1", primaryInputs);
+        LogicCircuit c2_renamed = renameCircuit(circuit2, "_c2", primaryInputs);
+
+        for (const auto& gate : c1_renamed.gates) combined.addGate(gate);
+        for (const auto& gate : c2_renamed.gates) combined.addGate(gate);
+
+        combined.wires.insert(c1_renamed.wires.begin(), c1_renamed.wires.end());
+        combined.wires.insert(c2_renamed.wires.begin(), c2_renamed.wires.end());
+
+        // ---- Add XORs to detect differences in outputs ----
+        std::vector<std::string> diffSignals;
+        for (const auto& out : miterOutputs) {
+            std::string out1 = out + "_c1";
+            std::string out2 = out + "_c2";
+            std::string diff = "diff_" + out;
+            addXORGate(combined, out1, out2, diff);
+            diffSignals.push_back(diff);
+            combined.wires.insert(diff);
+        }
+
+        // ---- OR all diff signals into anyDiff ----
+        std::string anyDiff = "any_diff";
+        addORGate(combined, diffSignals, anyDiff);
+        combined.wires.insert(anyDiff);
+
+        // ---- Structurally hash the miter so shared logic of both copies collapses ----
+        std::unordered_map<std::string, bool> constants;
+        LogicCircuit hashed = StructuralHasher::hash(combined, {anyDiff}, constants);
+
+        result.gatesBefore = combined.gates.size();
+        result.gatesAfter = hashed.gates.size();
+        for (const auto& diff : diffSignals) {
+            auto it = constants.find(diff);
+            if (it != constants.end() && !it->second) result.identicalOutputs++;
+        }
+
+        auto anyDiffConst = constants.find(anyDiff);
+        if (anyDiffConst != constants.end()) {
+            // any_diff folded to a constant: the query is decided without a solver
+            result.status = anyDiffConst->second ? MiterResult::Status::DIFFERENT
+                                                 : MiterResult::Status::EQUIVALENT;
+            writeTrivialCNF(cnfPath, result);
+            return result;
+        }
+
+        // ---- Convert to CNF ----
+        CNFConverter converter;
+        ClauseList cnf = converter.circuitToCNF(GateFusion::fuse(hashed, 3, {anyDiff}), {anyDiff});
+        result.variables = converter.getNumVariables();
+
+        // Force SAT query: any_diff = 1
+        auto varMap = converter.getVariableMap();
+        int anyDiffVar = varMap[anyDiff];
+        cnf.add({anyDiffVar});
+        result.clauses = cnf.size();
+
+        writeCNF(cnfPath, result.variables, cnf);
+        return result;
+    }
+
+    // ---- Smallest CNF with the answer of an already decided query ----
+    static void writeTrivialCNF(const std::string& cnfPath, MiterResult& result) {
+        ClauseList cnf;
+        cnf.add({1});
+        if (result.status == MiterResult::Status::EQUIVALENT) cnf.add({-1});
+        result.variables = 1;
+        result.clauses = cnf.size();
+        writeCNF(cnfPath, result.variables, cnf);
+    }
+
+    static void writeCNF(const std::string& cnfPath, int variables, const ClauseList& cnf) {
+        std::ofstream out(cnfPath);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot write " + cnfPath);
+        }
+        out << "c Equivalence checking CNF\n";
+        out << "c SAT = circuits differ, UNSAT = circuits equivalent\n";
+        out << "p cnf " << variables << " " << cnf.size() << "\n";
+        for (const auto& clause : cnf) {
+            for (int lit : clause) out << lit << " ";
+            out << "0\n";
+        }
+    }
+
+    static const char* statusName(MiterResult::Status status) {
+        switch (status) {
+            case MiterResult::Status::EQUIVALENT: return "EQUIVALENT";
+            case MiterResult::Status::DIFFERENT: return "DIFFERENT";
+            case MiterResult::Status::UNDECIDED: return "UNDECIDED";
+        }
+        return "UNDECIDED";
+    }
+
+    // ---- Run `work(i)` for i in [0, count) on `jobs` worker threads ----
+    template <typename Work>
+    static void parallelFor(size_t count, unsigned jobs, Work work) {
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next++; i < count; i = next++) work(i);
+        };
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < jobs && t < count; t++) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+    }
+
 public:
     static bool checkEquivalence(const std::string& file1, const std::string& file2) {
         try {
@@ -87,95 +281,176 @@ public:
             std::cout << "Parsed Circuit 2: " << circuit2.inputs.size() << " inputs, "
                       << circuit2.outputs.size() << " outputs" << std::endl;
 
-            // ---- Check input/output compatibility ----
-            std::vector<std::string> inputs1(circuit1.inputs.begin(), circuit1.inputs.end());
-            std::vector<std::string> inputs2(circuit2.inputs.begin(), circuit2.inputs.end());
-            std::vector<std::string> outputs1(circuit1.outputs.begin(), circuit1.outputs.end());
-            std::vector<std::string> outputs2(circuit2.outputs.begin(), circuit2.outputs.end());
+            MiterResult result = writeMiterCNF(circuit1, circuit2, "equivalence.cnf");
+            std::cout << "Structural hashing: " << result.gatesBefore << " -> "
+                      << result.gatesAfter << " gates, " << result.identicalOutputs << "/"
+                      << result.comparedOutputs << " outputs structurally identical" << std::endl;
+            std::cout << "Truth tables: " << result.tableDecidedOutputs << "/" << result.comparedOutputs
+                      << " outputs decided exhaustively" << std::endl;
+            if (!result.counterexample.empty()) {
+                std::cout << "Counterexample: " << result.counterexample << std::endl;
+            }
+
+            std::cout << "Arena high-water: ";
+            PhaseArena::report(std::cout);
+            std::cout << std::endl;
 
-            std::sort(inputs1.begin(), inputs1.end());
-            std::sort(inputs2.begin(), inputs2.end());
-            std::sort(outputs1.begin(), outputs1.end());
-            std::sort(outputs2.begin(), outputs2.end());
+            std::cout << "Equivalence CNF written to equivalence.cnf" << std::endl;
+            return true;
 
-            if (inputs1 != inputs2) {
-                std::cerr << "Error: Circuits have different inputs!" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    // ---- Batch mode: check every pair of a manifest, parsing each unique file once ----
+    // Manifest lines are "<file1> <file2>"; blank lines and lines starting with '#' are
+    // ignored. Pair i is written to <cnfDir>/equivalence_<i>.cnf and summarized as one
+    // tab-separated row of `resultPath`.
+    static bool checkBatch(const std::string& manifestPath, const std::string& resultPath,
+                           const std::string& cnfDir, unsigned jobs) {
+        std::ifstream manifest(manifestPath);
+        if (!manifest.is_open()) {
+            std::cerr << "Error: Cannot open manifest " << manifestPath << std::endl;
+            return false;
+        }
+
+        std::vector<std::pair<std::string, std::string>> pairs;
+        std::vector<std::string> files;
+        std::unordered_map<std::string, size_t> fileIndex;
+        std::string line;
+        while (std::getline(manifest, line)) {
+            std::istringstream iss(line);
+            std::string file1, file2;
+            if (!(iss >> file1) || file1[0] == '#') continue;
+            if (!(iss >> file2)) {
+                std::cerr << "Error: Manifest line needs two files: " << line << std::endl;
                 return false;
             }
-            if (outputs1 != outputs2) {
-                std::cerr << "Error: Circuits have different outputs!" << std::endl;
-                return false;
+            for (const auto& f : {file1, file2}) {
+                if (fileIndex.emplace(f, files.size()).second) files.push_back(f);
             }
+            pairs.push_back({file1, file2});
+        }
 
-            if (inputs1.empty() || outputs1.empty()) {
-                std::cerr << "Error: Circuits must have inputs and outputs!" << std::endl;
-                return false;
+        // ---- Parse cache: one parse per unique file, shared read-only by all pairs ----
+        std::vector<LogicCircuit> circuits(files.size());
+        std::vector<std::string> parseErrors(files.size());
+        parallelFor(files.size(), jobs, [&](size_t i) {
+            try {
+                circuits[i] = VerilogParser::parse(files[i]);
+            } catch (const std::exception& e) {
+                parseErrors[i] = e.what();
             }
+        });
 
-            // ---- Combine circuits with shared inputs but renamed internal signals ----
-            LogicCircuit combined;
-            std::unordered_set<std::string> primaryInputs = circuit1.inputs;
-            combined.inputs = primaryInputs;
-
-            LogicCircuit c1_renamed = renameCircuit(circuit1, "_c1", primaryInputs);
-            LogicCircuit c2_renamed = renameCircuit(circuit2, "_c2", primaryInputs);
-
-            for (const auto& gate : c1_renamed.gates) combined.addGate(gate);
-            for (const auto& gate : c2_renamed.gates) combined.addGate(gate);
-
-            combined.wires.insert(c1_renamed.wires.begin(), c1_renamed.wires.end());
-            combined.wires.insert(c2_renamed.wires.begin(), c2_renamed.wires.end());
-
-            // ---- Add XORs to detect differences in outputs ----
-            std::vector<std::string> diffSignals;
-            for (const auto& out : outputs1) {
-                std::string out1 = out + "_c1";
-                std::string out2 = out + "_c2";
-                std::string diff = "diff_" + out;
-                addXORGate(combined, out1, out2, diff);
-                diffSignals.push_back(diff);
-                combined.wires.insert(diff);
+        // ---- Check the pairs ----
+        std::vector<MiterResult> results(pairs.size());
+        std::vector<std::string> errors(pairs.size());
+        parallelFor(pairs.size(), jobs, [&](size_t i) {
+            size_t f1 = fileIndex[pairs[i].first];
+            size_t f2 = fileIndex[pairs[i].second];
+            if (!parseErrors[f1].empty() || !parseErrors[f2].empty()) {
+                errors[i] = "parse: " + (parseErrors[f1].empty() ? parseErrors[f2] : parseErrors[f1]);
+                return;
             }
-
-            // ---- OR all diff signals into anyDiff ----
-            std::string anyDiff = "any_diff";
-            addORGate(combined, diffSignals, anyDiff);
-            combined.wires.insert(anyDiff);
-
-            // ---- Convert to CNF ----
-            CNFConverter converter;
-            auto cnf = converter.circuitToCNF(combined);
-            auto varMap = converter.getVariableMap();
-
-            // Force SAT query: any_diff = 1
-            int anyDiffVar = varMap[anyDiff];
-            cnf.push_back({anyDiffVar});
-
-            // ---- Write CNF to file ----
-            std::ofstream out("equivalence.cnf");
-            out << "c Equivalence checking CNF\n";
-            out << "c SAT = circuits differ, UNSAT = circuits equivalent\n";
-            out << "p cnf " << converter.getNumVariables() << " " << cnf.size() << "\n";
-            for (const auto& clause : cnf) {
-                for (int lit : clause) out << lit << " ";
-                out << "0\n";
+            try {
+                results[i] = writeMiterCNF(circuits[f1], circuits[f2],
+                                           cnfDir + "/equivalence_" + std::to_string(i) + ".cnf");
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
             }
-            out.close();
-
-            std::cout << "Equivalence CNF written to equivalence.cnf" << std::endl;
-            return true;
+        });
 
-        } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
+        // ---- Result table ----
+        std::ofstream out(resultPath);
+        if (!out.is_open()) {
+            std::cerr << "Error: Cannot write " << resultPath << std::endl;
             return false;
         }
+        out << "pair\tfile1\tfile2\tstatus\tcnf\tvariables\tclauses\tgates\thashed_gates"
+               "\tidentical_outputs\ttable_outputs\toutputs\tmessage\n";
+        size_t failed = 0;
+        for (size_t i = 0; i < pairs.size(); i++) {
+            const MiterResult& r = results[i];
+            out << i << "\t" << pairs[i].first << "\t" << pairs[i].second << "\t";
+            if (!errors[i].empty()) {
+                failed++;
+                out << "ERROR\t-\t0\t0\t0\t0\t0\t0\t0\t" << errors[i] << "\n";
+                continue;
+            }
+            out << statusName(r.status) << "\t" << cnfDir << "/equivalence_" << i << ".cnf\t"
+                << r.variables << "\t" << r.clauses << "\t" << r.gatesBefore << "\t"
+                << r.gatesAfter << "\t" << r.identicalOutputs << "\t" << r.tableDecidedOutputs << "\t"
+                << r.comparedOutputs << "\t" << (r.counterexample.empty() ? "-" : r.counterexample) << "\n";
+        }
+        out.close();
+
+        std::cout << "Checked " << pairs.size() << " pairs over " << files.size()
+                  << " unique files (" << failed << " errors), results written to "
+                  << resultPath << std::endl;
+        return failed == 0;
     }
 };
 
 // ---- Driver ----
+// --adder ARCH, --multiplier ARCH, --pp-order row|canonical, --compare tseitin|direct.
+// Returns false for other options; `ok` is cleared (after a message) when the value is
+// not recognized.
+static bool arithmeticOption(const std::string& opt, const std::string& value, bool& ok) {
+    if (opt == "--adder") {
+        ok = ArithmeticBuilder::parseArchitecture(value, VerilogParser::adderArchitecture);
+    } else if (opt == "--multiplier") {
+        ok = ArithmeticBuilder::parseArchitecture(value, VerilogParser::multiplierArchitecture);
+    } else if (opt == "--pp-order") {
+        ok = value == "row" || value == "canonical";
+        VerilogParser::canonicalPartialProducts = value == "canonical";
+    } else if (opt == "--compare") {
+        ok = value == "tseitin" || value == "direct";
+        VerilogParser::directComparators = value == "direct";
+    } else {
+        return false;
+    }
+    if (!ok) std::cerr << "Unknown value for " << opt << ": " << value << std::endl;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Usage: ./equiv_checker <verilog_file1> <verilog_file2>" << std::endl;
+    if (argc >= 3 && std::string(argv[1]) == "--batch") {
+        std::string resultPath = "equivalence_results.tsv";
+        std::string cnfDir = ".";
+        unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+        bool ok = true;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string opt = argv[i];
+            if (opt == "--out") resultPath = argv[i + 1];
+            else if (opt == "--cnf-dir") cnfDir = argv[i + 1];
+            else if (opt == "--jobs") jobs = std::max(1, std::atoi(argv[i + 1]));
+            else if (arithmeticOption(opt, argv[i + 1], ok)) {
+                if (!ok) return 1;
+            }
+            else {
+                std::cerr << "Unknown option: " << opt << std::endl;
+                return 1;
+            }
+        }
+        return EquivalenceChecker::checkBatch(argv[2], resultPath, cnfDir, jobs) ? 0 : 1;
+    }
+
+    bool usage = argc < 3;
+    for (int i = 3; i < argc && !usage; i += 2) {
+        bool ok = true;
+        if (i + 1 >= argc || !arithmeticOption(argv[i], argv[i + 1], ok)) usage = true;
+        else if (!ok) return 1;
+    }
+    if (usage) {
+        std::cerr << "Usage: ./equiv_checker <verilog_file1> <verilog_file2> [datapath options]" << std::endl;
+        std::cerr << "       ./equiv_checker --batch <manifest> [--out results.tsv] [--cnf-dir dir] [--jobs N]"
+                     " [datapath options]" << std::endl;
+        std::cerr << "Datapath options: --adder ARCH, --multiplier dadda|wallace, --pp-order row|canonical,"
+                     " --compare tseitin|direct" << std::endl;
+        std::cerr << "ARCH: ripple (default), cla, kogge-stone, brent-kung, sklansky" << std::endl;
         std::cerr << "Generates equivalence.cnf for SAT-based equivalence checking." << std::endl;
         return 1;
     }
@@ -189,4 +464,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
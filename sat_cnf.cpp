@@ -1,1242 +1,249 @@
+#include "ver2cnf.h"
+#include "simulator.h"
+#include "truth_table.h"
+#include "codegen.h"
+#include "arithmetic.h"
+#include "bmc.h"
 #include <iostream>
+#include <iomanip>
 #include <vector>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
-#include <sstream>
-#include <regex>
 #include <fstream>
+#include <sstream>
 #include <algorithm>
-#include <cctype>
-#include <cassert>
+#include <chrono>
+#include <cstdlib>
 using namespace std;
 
-// ---------------- Gate ----------------
-class Gate {
-public:
-    enum class Type { AND, OR, NOT, XOR, XNOR, NAND, NOR, BUF, MUX };
-    Type type;
-    vector<string> inputs;
-    string output;
-
-    Gate(Type t, vector<string> in, string out) : type(t), inputs(in), output(out) {}
-};
-
-// ---------------- LogicCircuit ----------------
-class LogicCircuit {
-public:
-    string name;
-    vector<Gate> gates;
-    unordered_set<string> inputs;
-    unordered_set<string> outputs;
-    unordered_set<string> wires;
-    unordered_set<string> registers;
-
-    void addGate(const Gate& gate) {
-        gates.push_back(gate);
-        wires.insert(gate.output);
-        for (const auto& in : gate.inputs) {
-            wires.insert(in);
-        }
-    }
-
-    vector<string> getOutputs() const {
-        unordered_set<string> allInputs;
-        for (const auto& gate : gates) {
-            for (const auto& in : gate.inputs) {
-                allInputs.insert(in);
-            }
-        }
-
-        vector<string> result;
-        for (const auto& wire : wires) {
-            if (allInputs.find(wire) == allInputs.end()) {
-                result.push_back(wire);
-            }
-        }
-
-        for (const auto& out : outputs) {
-            if (find(result.begin(), result.end(), out) == result.end()) {
-                result.push_back(out);
-            }
-        }
-
-        sort(result.begin(), result.end());
-        return result;
-    }
-
-    vector<string> getInputs() const {
-        vector<string> result(inputs.begin(), inputs.end());
-        sort(result.begin(), result.end());
-        return result;
-    }
-};
-
-// ---------------- CNFConverter ----------------
-class CNFConverter {
-private:
-    int variableCounter;
-    unordered_map<string, int> variableMap;
-
-    int getVariable(const string& name) {
-        if (variableMap.find(name) == variableMap.end()) {
-            variableCounter++;
-            variableMap[name] = variableCounter;
-        }
-        return variableMap[name];
-    }
-
-    void resetVariables() {
-        variableCounter = 0;
-        variableMap.clear();
-    }
-
-    vector<vector<int>> gateToCNF(const Gate& gate) {
-        vector<vector<int>> clauses;
-        int outputVar = getVariable(gate.output);
-        vector<int> inputVars;
-        for (const auto& in : gate.inputs) {
-            inputVars.push_back(getVariable(in));
-        }
-
-        if (gate.type == Gate::Type::AND) {
-            for (int inpVar : inputVars) {
-                clauses.push_back({-outputVar, inpVar});
-            }
-            vector<int> clause = {outputVar};
-            for (int inpVar : inputVars) {
-                clause.push_back(-inpVar);
-            }
-            clauses.push_back(clause);
-        }
-        else if (gate.type == Gate::Type::OR) {
-            for (int inpVar : inputVars) {
-                clauses.push_back({inpVar, -outputVar});
-            }
-            vector<int> clause = {-outputVar};
-            clause.insert(clause.end(), inputVars.begin(), inputVars.end());
-            clauses.push_back(clause);
-        }
-        else if (gate.type == Gate::Type::NOT) {
-            int inpVar = inputVars[0];
-            clauses.push_back({-outputVar, -inpVar});
-            clauses.push_back({outputVar, inpVar});
-        }
-        else if (gate.type == Gate::Type::XOR) {
-            int a = inputVars[0];
-            int b = inputVars[1];
-            clauses.push_back({-a, -b, -outputVar});
-            clauses.push_back({a, b, -outputVar});
-            clauses.push_back({a, -b, outputVar});
-            clauses.push_back({-a, b, outputVar});
-        }
-        else if (gate.type == Gate::Type::XNOR) {
-            int a = inputVars[0];
-            int b = inputVars[1];
-            clauses.push_back({a, b, -outputVar});
-            clauses.push_back({-a, -b, -outputVar});
-            clauses.push_back({-a, b, outputVar});
-            clauses.push_back({a, -b, outputVar});
-        }
-        else if (gate.type == Gate::Type::NAND) {
-            int a = inputVars[0];
-            int b = inputVars[1];
-            clauses.push_back({-a, -b, outputVar});
-            clauses.push_back({-outputVar, a});
-            clauses.push_back({-outputVar, b});
-        }
-        else if (gate.type == Gate::Type::NOR) {
-            int a = inputVars[0];
-            int b = inputVars[1];
-            clauses.push_back({-a, -b, outputVar});
-            clauses.push_back({-outputVar, -a});
-            clauses.push_back({-outputVar, -b});
-        }
-        else if (gate.type == Gate::Type::MUX) {
-            int a = inputVars[0];
-            int b = inputVars[1];
-            int sel = inputVars[2];
-            clauses.push_back({-sel, -a, outputVar});
-            clauses.push_back({sel, -b, outputVar});
-            clauses.push_back({-outputVar, -sel, a});
-            clauses.push_back({-outputVar, sel, b});
-        } else if(gate.type==Gate::Type::BUF) {
-            clauses.push_back({-outputVar,inputVars[0]});
-            clauses.push_back({outputVar,-inputVars[0]});
-        }
-
-        return clauses;
-    }
-
-public:
-    CNFConverter() : variableCounter(0) {}
-
-    vector<vector<int>> circuitToCNF(const LogicCircuit& circuit) {
-        resetVariables();
-        vector<vector<int>> clauses;
-
-        for (const auto& wire : circuit.wires) {
-            getVariable(wire);
-        }
-
-        for (const auto& gate : circuit.gates) {
-            auto getClauses = gateToCNF(gate);
-            clauses.insert(clauses.end(), getClauses.begin(), getClauses.end());
-        }
-
-        return clauses;
-    }
-
-    unordered_map<string, int> getVariableMap() const {
-        return variableMap;
-    }
+// ---------------- SIMULATION ----------------
+// --simulate <stimulus_file>: prints every output as hex words, pattern p is bit p % 64 of word p / 64
+// --simulate-random <patterns> [seed]: random stimulus, prints per-output ones-count and throughput
+static int runSimulation(const LogicCircuit& circuit, const string& stimulusFile, size_t randomPatterns, uint64_t seed) {
+    LogicSimulator sim(circuit);
 
-    int getNumVariables() const {
-        return variableCounter;
+    size_t patterns = randomPatterns;
+    vector<uint64_t> stimulus;
+    if (!stimulusFile.empty()) {
+        stimulus = sim.readStimulus(stimulusFile, patterns);
     }
-};
-
-// ---------------- VerilogParser ----------------
-class VerilogParser {
-private:
-    static string generateTempName(const string& base, int& counter) {
-        return base + "_temp_" + to_string(counter++);
+    size_t words = (patterns + 63) / 64;
+    if (stimulusFile.empty()) {
+        stimulus = sim.randomStimulus(words, seed);
     }
 
-    static string trim(const string& s) {
-        auto start = find_if(s.begin(), s.end(), [](unsigned char c) { return !isspace(c); });
-        auto end = find_if(s.rbegin(), s.rend(), [](unsigned char c) { return !isspace(c); }).base();
-        return (start < end) ? string(start, end) : "";
-    }
-
-    static bool isVectorBase(const string& name, const LogicCircuit& circuit) {
-        for (const auto& signal : circuit.inputs) {
-            if (signal.length() > name.length() + 2 && 
-                signal.substr(0, name.length()) == name && 
-                signal[name.length()] == '[') {
-                return true;
-            }
-        }
-        for (const auto& signal : circuit.outputs) {
-            if (signal.length() > name.length() + 2 && 
-                signal.substr(0, name.length()) == name && 
-                signal[name.length()] == '[') {
-                return true;
-            }
-        }
-        return false;
-    }
-
-    static vector<string> getVectorBits(const string& baseName, const LogicCircuit& circuit) {
-        vector<string> bits;
-        
-        for (const auto& signal : circuit.outputs) {
-            if (signal.length() > baseName.length() + 2 && 
-                signal.substr(0, baseName.length()) == baseName && 
-                signal[baseName.length()] == '[') {
-                bits.push_back(signal);
-            }
-        }
-        
-        if (bits.empty()) {
-            for (const auto& signal : circuit.inputs) {
-                if (signal.length() > baseName.length() + 2 && 
-                    signal.substr(0, baseName.length()) == baseName && 
-                    signal[baseName.length()] == '[') {
-                    bits.push_back(signal);
-                }
-            }
-        }
-        
-        sort(bits.begin(), bits.end(), [](const string& a, const string& b) {
-            size_t a_start = a.find('[') + 1;
-            size_t a_end = a.find(']', a_start);
-            size_t b_start = b.find('[') + 1;
-            size_t b_end = b.find(']', b_start);
-            
-            if (a_start != string::npos && a_end != string::npos && 
-                b_start != string::npos && b_end != string::npos) {
-                int a_idx = stoi(a.substr(a_start, a_end - a_start));
-                int b_idx = stoi(b.substr(b_start, b_end - b_start));
-                return a_idx > b_idx;
-            }
-            return a < b;
-        });
-        
-        return bits;
-    }
-
-    static string generateAdder(const string& leftOp, const string& rightOp, 
-                               const string& target, LogicCircuit& circuit, int& tempCounter) {
-        cout << "DEBUG ADDER: Generating adder for " << leftOp << " + " << rightOp << " -> " << target << endl;
-        
-        if (isVectorBase(target, circuit)) {
-            vector<string> targetBits = getVectorBits(target, circuit);
-            vector<string> leftBits = getVectorBits(leftOp, circuit);
-            vector<string> rightBits = getVectorBits(rightOp, circuit);
-            
-            if (targetBits.empty() || leftBits.empty() || rightBits.empty()) {
-                throw runtime_error("Cannot find vector bits for addition operands");
-            }
-            
-            int width = targetBits.size();
-            if (leftBits.size() != width || rightBits.size() != width) {
-                throw runtime_error("Vector width mismatch in addition");
-            }
-            
-            string carryIn = "";
-            
-            for (int i = width - 1; i >= 0; i--) {
-                string a = leftBits[i];
-                string b = rightBits[i];
-                string sum = targetBits[i];
-                string carryOut = (i > 0) ? generateTempName("carry", tempCounter) : "";
-                
-                if (carryIn.empty()) {
-                    circuit.addGate(Gate(Gate::Type::XOR, {a, b}, sum));
-                    if (!carryOut.empty()) {
-                        circuit.addGate(Gate(Gate::Type::AND, {a, b}, carryOut));
-                    }
-                } else {
-                    string xor1 = generateTempName("xor", tempCounter);
-                    circuit.addGate(Gate(Gate::Type::XOR, {a, b}, xor1));
-                    circuit.addGate(Gate(Gate::Type::XOR, {xor1, carryIn}, sum));
-                    
-                    if (!carryOut.empty()) {
-                        string and1 = generateTempName("and", tempCounter);
-                        string and2 = generateTempName("and", tempCounter);
-                        circuit.addGate(Gate(Gate::Type::AND, {a, b}, and1));
-                        circuit.addGate(Gate(Gate::Type::AND, {xor1, carryIn}, and2));
-                        circuit.addGate(Gate(Gate::Type::OR, {and1, and2}, carryOut));
-                    }
-                }
-                
-                carryIn = carryOut;
-            }
-            
-            return target;
-        } else {
-            throw runtime_error("Scalar addition not yet supported - use vector types");
-        }
-    }
-    
-    static string generateSubtractor(const string& leftOp, const string& rightOp,
-                                    const string& target, LogicCircuit& circuit, int& tempCounter) {
-        cout << "DEBUG SUBTRACTOR: Generating subtractor for " << leftOp << " - " << rightOp << " -> " << target << endl;
-        
-        if (isVectorBase(target, circuit)) {
-            vector<string> targetBits = getVectorBits(target, circuit);
-            vector<string> leftBits = getVectorBits(leftOp, circuit);
-            vector<string> rightBits = getVectorBits(rightOp, circuit);
-            
-            if (targetBits.empty() || leftBits.empty() || rightBits.empty()) {
-                throw runtime_error("Cannot find vector bits for subtraction operands");
-            }
-            
-            int width = targetBits.size();
-            if (leftBits.size() != width || rightBits.size() != width) {
-                throw runtime_error("Vector width mismatch in subtraction");
-            }
-            
-            vector<string> rightInverted(width);
-            for (int i = 0; i < width; i++) {
-                rightInverted[i] = generateTempName("inv", tempCounter);
-                circuit.addGate(Gate(Gate::Type::NOT, {rightBits[i]}, rightInverted[i]));
-            }
-            
-            string carryIn = "";
-            
-            for (int i = width - 1; i >= 0; i--) {
-                string a = leftBits[i];
-                string b = rightInverted[i];
-                string sum = targetBits[i];
-                string carryOut = (i > 0) ? generateTempName("carry", tempCounter) : "";
-                
-                if (i == width - 1) {
-                    string xor1 = generateTempName("xor", tempCounter);
-                    circuit.addGate(Gate(Gate::Type::XOR, {a, b}, xor1));
-                    circuit.addGate(Gate(Gate::Type::NOT, {xor1}, sum));
-                    
-                    if (!carryOut.empty()) {
-                        string and1 = generateTempName("and", tempCounter);
-                        circuit.addGate(Gate(Gate::Type::AND, {a, b}, and1));
-                        circuit.addGate(Gate(Gate::Type::OR, {and1, xor1}, carryOut));
-                    }
-                    carryIn = carryOut;
-                } else {
-                    string xor1 = generateTempName("xor", tempCounter);
-                    circuit.addGate(Gate(Gate::Type::XOR, {a, b}, xor1));
-                    circuit.addGate(Gate(Gate::Type::XOR, {xor1, carryIn}, sum));
-                    
-                    if (!carryOut.empty()) {
-                        string and1 = generateTempName("and", tempCounter);
-                        string and2 = generateTempName("and", tempCounter);
-                        circuit.addGate(Gate(Gate::Type::AND, {a, b}, and1));
-                        circuit.addGate(Gate(Gate::Type::AND, {xor1, carryIn}, and2));
-                        circuit.addGate(Gate(Gate::Type::OR, {and1, and2}, carryOut));
-                    }
-                    carryIn = carryOut;
-                }
-            }
-            
-            return target;
-        } else {
-            throw runtime_error("Scalar subtraction not yet supported - use vector types");
-        }
-    }
-
-    static vector<string> tokenize(const string& expr) {
-        vector<string> tokens;
-        string current;
-        int parenCount = 0;
-        
-        for (size_t i = 0; i < expr.length(); i++) {
-            char c = expr[i];
-            if (isspace(c)) continue;
-            
-            if (c == '(') {
-                if (!current.empty()) {
-                    tokens.push_back(current);
-                    current = "";
-                }
-                parenCount++;
-                tokens.push_back("(");
-            }
-            else if (c == ')') {
-                if (!current.empty()) {
-                    tokens.push_back(current);
-                    current = "";
-                }
-                tokens.push_back(")");
-                parenCount--;
-            }
-            else if ((c == '&' || c == '|' || c == '^') && parenCount == 0) {
-                if (!current.empty()) {
-                    tokens.push_back(current);
-                    current = "";
-                }
-                if (c == '&' && i + 1 < expr.length() && expr[i + 1] == '&') {
-                    tokens.push_back("&&");
-                    i++;
-                }
-                else if (c == '|' && i + 1 < expr.length() && expr[i + 1] == '|') {
-                    tokens.push_back("||");
-                    i++;
-                }
-                else if (c == '^' && i + 1 < expr.length() && expr[i + 1] == '~') {
-                    tokens.push_back("^~");
-                    i++;
-                }
-                else if (c == '~' && i + 1 < expr.length() && expr[i + 1] == '^') {
-                    tokens.push_back("~^");
-                    i++;
-                }
-                else {
-                    tokens.push_back(string(1, c));
-                }
-            }
-            else if (c == '~' || c == '!') {
-                if (!current.empty()) {
-                    tokens.push_back(current);
-                    current = "";
-                }
-                tokens.push_back(string(1, c));
-            }
-            else {
-                current += c;
-            }
-        }
-        
-        if (!current.empty()) {
-            tokens.push_back(current);
-        }
-        
-        return tokens;
-    }
-
-    static string extractBaseName(const string& signal) {
-        size_t pos = signal.find('[');
-        if (pos != string::npos) {
-            return signal.substr(0, pos);
-        }
-        return signal;
-    }
-
-    static string parseExpression(const string& expr, const string& target, 
-                                LogicCircuit& circuit, int& tempCounter) {
-        string cleaned = expr;
-        cleaned.erase(remove_if(cleaned.begin(), cleaned.end(), ::isspace), cleaned.end());
-        
-        if (cleaned.empty()) return "";
-        
-        size_t plusPos = cleaned.find('+');
-        if (plusPos != string::npos && plusPos > 0 && plusPos < cleaned.length() - 1) {
-            int parenCount = 0;
-            bool topLevel = true;
-            for (size_t i = 0; i < plusPos; i++) {
-                if (cleaned[i] == '(') parenCount++;
-                else if (cleaned[i] == ')') parenCount--;
-            }
-            if (parenCount != 0) topLevel = false;
-            
-            if (topLevel) {
-                string leftOp = cleaned.substr(0, plusPos);
-                string rightOp = cleaned.substr(plusPos + 1);
-                
-                string leftBase = extractBaseName(leftOp);
-                string rightBase = extractBaseName(rightOp);
-                string targetBase = extractBaseName(target);
-                
-                if (isVectorBase(leftBase, circuit) && isVectorBase(rightBase, circuit)) {
-                    return generateAdder(leftBase, rightBase, targetBase, circuit, tempCounter);
-                } else {
-                    return generateAdder(leftOp, rightOp, target, circuit, tempCounter);
-                }
-            }
-        }
-        
-        size_t minusPos = cleaned.find('-');
-        if (minusPos != string::npos && minusPos > 0 && minusPos < cleaned.length() - 1) {
-            int parenCount = 0;
-            bool topLevel = true;
-            for (size_t i = 0; i < minusPos; i++) {
-                if (cleaned[i] == '(') parenCount++;
-                else if (cleaned[i] == ')') parenCount--;
-            }
-            if (parenCount != 0) topLevel = false;
-            
-            if (topLevel) {
-                string leftOp = cleaned.substr(0, minusPos);
-                string rightOp = cleaned.substr(minusPos + 1);
-                
-                string leftBase = extractBaseName(leftOp);
-                string rightBase = extractBaseName(rightOp);
-                string targetBase = extractBaseName(target);
-                
-                if (isVectorBase(leftBase, circuit) && isVectorBase(rightBase, circuit)) {
-                    return generateSubtractor(leftBase, rightBase, targetBase, circuit, tempCounter);
-                } else {
-                    return generateSubtractor(leftOp, rightOp, target, circuit, tempCounter);
-                }
-            }
-        }
-        
-        size_t quesPos = cleaned.find('?');
-        size_t colonPos = cleaned.find(':', quesPos);
-        if (quesPos != string::npos && colonPos != string::npos) {
-            int parenCount = 0;
-            bool validQues = true, validColon = true;
-            for (size_t i = 0; i < quesPos; i++) {
-                if (cleaned[i] == '(') parenCount++;
-                else if (cleaned[i] == ')') parenCount--;
-            }
-            if (parenCount != 0) validQues = false;
-            
-            parenCount = 0;
-            for (size_t i = 0; i <= colonPos; i++) {
-                if (cleaned[i] == '(') parenCount++;
-                else if (cleaned[i] == ')') parenCount--;
-            }
-            if (parenCount != 0) validColon = false;
-            
-            if (validQues && validColon) {
-                string sel = cleaned.substr(0, quesPos);
-                string b = cleaned.substr(quesPos + 1, colonPos - quesPos - 1);
-                string a = cleaned.substr(colonPos + 1);
-                string selParsed = parseExpression(sel, target + "_sel", circuit, tempCounter);
-                string aParsed = parseExpression(a, target + "_a", circuit, tempCounter);
-                string bParsed = parseExpression(b, target + "_b", circuit, tempCounter);
-                circuit.addGate(Gate(Gate::Type::MUX, {aParsed, bParsed, selParsed}, target));
-                return target;
-            }
-        }
-        
-        if (cleaned.size() >= 4 && cleaned[0] == '~' && cleaned[1] == '(' && cleaned.back() == ')') {
-            string inner = cleaned.substr(2, cleaned.size() - 3);
-            vector<string> innerTokens = tokenize(inner);
-            for (size_t i = 0; i < innerTokens.size(); i++) {
-                if (innerTokens[i] == "^") {
-                    size_t opPos = inner.find('^');
-                    if (opPos != string::npos) {
-                        string left = inner.substr(0, opPos);
-                        string right = inner.substr(opPos + 1);
-                        left.erase(remove_if(left.begin(), left.end(), ::isspace), left.end());
-                        right.erase(remove_if(right.begin(), right.end(), ::isspace), right.end());
-                        if (!left.empty() && !right.empty()) {
-                            string leftParsed = parseExpression(left, target + "_left", circuit, tempCounter);
-                            string rightParsed = parseExpression(right, target + "_right", circuit, tempCounter);
-                            circuit.addGate(Gate(Gate::Type::XNOR, {leftParsed, rightParsed}, target));
-                            return target;
-                        }
-                    }
-                }
-                else if (innerTokens[i] == "|") {
-                    size_t opPos = inner.find('|');
-                    if (opPos != string::npos) {
-                        string left = inner.substr(0, opPos);
-                        string right = inner.substr(opPos + 1);
-                        left.erase(remove_if(left.begin(), left.end(), ::isspace), left.end());
-                        right.erase(remove_if(right.begin(), right.end(), ::isspace), right.end());
-                        if (!left.empty() && !right.empty()) {
-                            string leftParsed = parseExpression(left, target + "_left", circuit, tempCounter);
-                            string rightParsed = parseExpression(right, target + "_right", circuit, tempCounter);
-                            circuit.addGate(Gate(Gate::Type::NOR, {leftParsed, rightParsed}, target));
-                            return target;
-                        }
-                    }
-                }
-                else if (innerTokens[i] == "&") {
-                    size_t opPos = inner.find('&');
-                    if (opPos != string::npos) {
-                        string left = inner.substr(0, opPos);
-                        string right = inner.substr(opPos + 1);
-                        left.erase(remove_if(left.begin(), left.end(), ::isspace), left.end());
-                        right.erase(remove_if(right.begin(), right.end(), ::isspace), right.end());
-                        if (!left.empty() && !right.empty()) {
-                            string leftParsed = parseExpression(left, target + "_left", circuit, tempCounter);
-                            string rightParsed = parseExpression(right, target + "_right", circuit, tempCounter);
-                            circuit.addGate(Gate(Gate::Type::NAND, {leftParsed, rightParsed}, target));
-                            return target;
-                        }
-                    }
-                }
-            }
-        }
-        
-        if (cleaned[0] == '~' || cleaned[0] == '!') {
-            string operand = cleaned.substr(1);
-            string operandParsed = parseExpression(operand, target + "_not", circuit, tempCounter);
-            circuit.addGate(Gate(Gate::Type::NOT, {operandParsed}, target));
-            return target;
-        }
-        
-        if (cleaned.front() == '(' && cleaned.back() == ')') {
-            int parenCount = 0;
-            bool balanced = true;
-            for (size_t i = 0; i < cleaned.size(); i++) {
-                if (cleaned[i] == '(') parenCount++;
-                else if (cleaned[i] == ')') parenCount--;
-                if (parenCount == 0 && i < cleaned.size() - 1) {
-                    balanced = false;
-                    break;
-                }
-            }
-            if (balanced) {
-                return parseExpression(cleaned.substr(1, cleaned.size() - 2), target, circuit, tempCounter);
-            }
-        }
-        
-        vector<string> tokens = tokenize(cleaned);
-        
-        vector<string> xorParts;
-        string currentPart;
-        int parenCount = 0;
-        for (const string& token : tokens) {
-            if (token == "(") parenCount++;
-            else if (token == ")") parenCount--;
-            else if (token == "^" && parenCount == 0) {
-                if (!currentPart.empty()) {
-                    xorParts.push_back(currentPart);
-                    currentPart = "";
-                }
-                continue;
-            }
-            if (!currentPart.empty()) currentPart += " ";
-            currentPart += token;
-        }
-        if (!currentPart.empty()) xorParts.push_back(currentPart);
-        
-        if (xorParts.size() > 1) {
-            string current = parseExpression(xorParts[0], target + "_xor0", circuit, tempCounter);
-            for (size_t i = 1; i < xorParts.size(); i++) {
-                string nextPart = parseExpression(xorParts[i], target + "_xor" + to_string(i), circuit, tempCounter);
-                string tempName = (i == xorParts.size() - 1) ? target : generateTempName(target + "_xor", tempCounter);
-                circuit.addGate(Gate(Gate::Type::XOR, {current, nextPart}, tempName));
-                current = tempName;
-            }
-            return target;
-        }
-        
-        vector<string> orParts;
-        currentPart = "";
-        parenCount = 0;
-        for (const string& token : tokens) {
-            if (token == "(") parenCount++;
-            else if (token == ")") parenCount--;
-            else if ((token == "|" || token == "||") && parenCount == 0) {
-                if (!currentPart.empty()) {
-                    orParts.push_back(currentPart);
-                    currentPart = "";
-                }
-                continue;
-            }
-            if (!currentPart.empty()) currentPart += " ";
-            currentPart += token;
-        }
-        if (!currentPart.empty()) orParts.push_back(currentPart);
-        
-        if (orParts.size() > 1) {
-            string current = parseExpression(orParts[0], target + "_or0", circuit, tempCounter);
-            for (size_t i = 1; i < orParts.size(); i++) {
-                string nextPart = parseExpression(orParts[i], target + "_or" + to_string(i), circuit, tempCounter);
-                string tempName = (i == orParts.size() - 1) ? target : generateTempName(target + "_or", tempCounter);
-                circuit.addGate(Gate(Gate::Type::OR, {current, nextPart}, tempName));
-                current = tempName;
-            }
-            return target;
-        }
-        
-        vector<string> andParts;
-        currentPart = "";
-        parenCount = 0;
-        for (const string& token : tokens) {
-            if (token == "(") parenCount++;
-            else if (token == ")") parenCount--;
-            else if ((token == "&" || token == "&&") && parenCount == 0) {
-                if (!currentPart.empty()) {
-                    andParts.push_back(currentPart);
-                    currentPart = "";
-                }
-                continue;
-            }
-            if (!currentPart.empty()) currentPart += " ";
-            currentPart += token;
-        }
-        if (!currentPart.empty()) andParts.push_back(currentPart);
-        
-        if (andParts.size() > 1) {
-            string current = parseExpression(andParts[0], target + "_and0", circuit, tempCounter);
-            for (size_t i = 1; i < andParts.size(); i++) {
-                string nextPart = parseExpression(andParts[i], target + "_and" + to_string(i), circuit, tempCounter);
-                string tempName = (i == andParts.size() - 1) ? target : generateTempName(target + "_and", tempCounter);
-                circuit.addGate(Gate(Gate::Type::AND, {current, nextPart}, tempName));
-                current = tempName;
-            }
-            return target;
-        }
-        
-        return cleaned;
-    }
-
-    static string readVerilogBlock(ifstream& file, string& firstLine) {
-        string block = firstLine;
-        string line;
-        int depth = 0;
-
-        if (firstLine.find("begin") != string::npos) {
-            depth = 1;
-        }
-
-        while (depth > 0 && getline(file, line)) {
-            auto commentPos = line.find("//");
-            if (commentPos != string::npos) {
-                line = line.substr(0, commentPos);
-            }
-
-            if (line.find("begin") != string::npos) {
-                depth++;
-            }
-            if (line.find("end") == 0 || 
-                (line.find_first_not_of(" \t") != string::npos && 
-                 line.find_first_not_of(" \t") == line.find("end"))) {
-                depth--;
-            }
-
-            block += "\n" + line;
-            if (depth == 0) break;
-        }
-
-        return block;
-    }
-
-    static void parseAlwaysBlock(const string& block, LogicCircuit& circuit) {
-        cout << "DEBUG ALWAYS: Processing always block" << endl;
-        
-        size_t atPos = block.find("@(");
-        if (atPos == string::npos) atPos = block.find("@*");
-        
-        if (atPos == string::npos || 
-            (block.find("@(*)") == string::npos && block.find("@*") == string::npos)) {
-            cout << "WARNING: Non-combinational always block skipped" << endl;
-            return;
-        }
-
-        istringstream iss(block);
-        string line;
-        bool inBlock = false;
-        
-        while (getline(iss, line)) {
-            auto commentPos = line.find("//");
-            if (commentPos != string::npos) {
-                line = line.substr(0, commentPos);
-            }
-            
-            string trimmed = trim(line);
-            
-            if (trimmed.find("always") != string::npos) {
-                continue;
-            }
-            
-            if (trimmed == "begin") {
-                inBlock = true;
-                continue;
-            }
-            
-            if (trimmed == "end" || trimmed.find("end") == 0) {
-                break;
-            }
-            
-            if (trimmed.empty()) continue;
-            
-            if (trimmed.find('=') != string::npos) {
-                parseAlwaysAssignment(trimmed, circuit);
-            }
-        }
-    }
-
-    static void parseAlwaysAssignment(const string& line, LogicCircuit& circuit) {
-        string cleaned = line;
-        cleaned.erase(remove(cleaned.begin(), cleaned.end(), ';'), cleaned.end());
-        
-        size_t eqPos = cleaned.find('=');
-        if (eqPos == string::npos) return;
-        
-        if (eqPos > 0 && cleaned[eqPos-1] == '<') {
-            cout << "WARNING: Non-blocking assignment in combinational logic - skipped" << endl;
-            return;
-        }
-
-        string lhs = cleaned.substr(0, eqPos);
-        string rhs = cleaned.substr(eqPos + 1);
-        
-        lhs = trim(lhs);
-        rhs = trim(rhs);
-        
-        if (lhs.empty() || rhs.empty()) return;
-        
-        string fakeAssign = "assign " + lhs + " = " + rhs + ";";
-        parseAssignment(fakeAssign, circuit);
-    }
-
-    static void parseGenerateBlock(const string& block, LogicCircuit& circuit) {
-        cout << "DEBUG GENERATE: Processing generate block" << endl;
-        
-        if (block.find("for") != string::npos) {
-            parseForGenerate(block, circuit);
-        }
-    }
-
-    // REPLACE your function with this fully corrected version.
-    static string evaluateGenerateExpression(string expr, const string& varName, int value) {
-        // This regex finds patterns like [i], [i+1], [1+i], [7-i], [i*2], [2*i] etc.
-        regex pattern(R"(\[(\s*(?:\w+|\d+)\s*(?:[\+\-\*]\s*(?:\w+|\d+)\s*)*)\])");
-        
-        // Use sregex_iterator for safe iteration over all matches
-        auto matches_begin = sregex_iterator(expr.begin(), expr.end(), pattern);
-        auto matches_end = sregex_iterator();
-
-        string result;
-        // FIX 1: Use cbegin() to get a const_iterator
-        auto last_match_end = expr.cbegin();
-
-        for (sregex_iterator i = matches_begin; i != matches_end; ++i) {
-            smatch match = *i;
-            string inner_expr = match[1].str();
-            
-            result.append(last_match_end, match.prefix().second);
-            
-            if (inner_expr.find(varName) != string::npos) {
-                string replaced_inner = regex_replace(inner_expr, regex("\\b" + varName + "\\b"), to_string(value));
-                
-                int finalValue = value;
-                smatch arith_match;
-                if (regex_match(replaced_inner, arith_match, regex(R"(\s*(\d+)\s*-\s*(\d+)\s*)"))) {
-                    finalValue = stoi(arith_match[1]) - stoi(arith_match[2]);
-                } else if (regex_match(replaced_inner, arith_match, regex(R"(\s*(\d+)\s*\+\s*(\d+)\s*)"))) {
-                    finalValue = stoi(arith_match[1]) + stoi(arith_match[2]);
-                } else if (regex_match(replaced_inner, arith_match, regex(R"(\s*(\d+)\s*)"))) {
-                    finalValue = stoi(arith_match[1]);
-                }
-                
-                result += "[" + to_string(finalValue) + "]";
-            } else {
-                result += "[" + inner_expr + "]";
-            }
-            
-            last_match_end = match.suffix().first;
-        }
-
-        // --- THIS IS THE NEW FIX ---
-        // Use cend() to get a const_iterator for the end of the string.
-        result.append(last_match_end, expr.cend());
-
-        return result;
-    }
-
-    // REPLACE the old parseForGenerate function with this one.
-    static void parseForGenerate(const string& block, LogicCircuit& circuit) {
-        // This regex is more robust:
-        // - Handles optional "genvar"
-        // - Captures the loop variable name (i)
-        // - Captures the start value
-        // - Captures the comparison operator (<, <=, >, >=)
-        // - Captures the end value
-        // - Handles both "i = i + S" and "i++" / "++i" style increments
-        regex forRegex(R"(for\s*\(\s*(?:genvar\s+)?(\w+)\s*=\s*(\d+)\s*;\s*\1\s*([<>]=?)\s*(\d+)\s*;\s*(?:(?:\+\+)?\s*\1(?:\s*\+\+)?|\1\s*=\s*\1\s*\+\s*(\d+))\s*\)\s*begin)");
-        smatch match;
-
-        if (regex_search(block, match, forRegex)) {
-            string varName = match[1].str();
-            int start = stoi(match[2].str());
-            string op = match[3].str();
-            int endCond = stoi(match[4].str());
-            int step = 1;
-            if (match[5].matched) { // Check if the "i = i + S" group was matched
-                step = stoi(match[5].str());
-            }
-
-            cout << "DEBUG GENERATE: Unrolling loop for " << varName 
-                << " from " << start << " with condition " << op << " " << endCond << " step " << step << endl;
-            
-            // Robustly find the body of the generate block
-            size_t bodyStartPos = block.find("begin", match.position(0));
-            if (bodyStartPos == string::npos) {
-                cout << "WARNING: Malformed for-generate block, 'begin' not found." << endl;
-                return;
-            }
-            bodyStartPos += 5; // move past "begin"
-
-            size_t bodyEndPos = string::npos;
-            int depth = 1;
-            for (size_t i = bodyStartPos; i < block.length(); ++i) {
-                if (i + 4 < block.length() && block.substr(i, 5) == "begin") {
-                    depth++;
-                    i += 4;
-                } else if (i + 2 < block.length() && block.substr(i, 3) == "end") {
-                    depth--;
-                    if (depth == 0) {
-                        bodyEndPos = i;
-                        break;
-                    }
-                    i += 2;
-                }
-            }
-
-            if (bodyEndPos == string::npos) {
-                cout << "WARNING: Malformed for-generate block, matching 'end' not found." << endl;
-                return;
-            }
-
-            string body = block.substr(bodyStartPos, bodyEndPos - bodyStartPos);
-
-            for (int i = start; ; i += step) {
-                // Check the end condition based on the captured operator
-                bool conditionMet;
-                if (op == "<") conditionMet = (i < endCond);
-                else if (op == "<=") conditionMet = (i <= endCond);
-                else if (op == ">") conditionMet = (i > endCond);
-                else if (op == ">=") conditionMet = (i >= endCond);
-                else { cout << "WARNING: Unknown operator in generate for loop" << endl; break; }
-
-                if (!conditionMet) break;
-
-                cout << "DEBUG GENERATE: Iteration " << varName << " = " << i << endl;
-                
-                // 1. First, replace the genvar if it appears in arithmetic expressions inside brackets []
-                string unrolledBody = evaluateGenerateExpression(body, varName, i);
-                
-                // 2. Then, replace any remaining standalone instances of the genvar
-                unrolledBody = regex_replace(unrolledBody, regex("\\b" + varName + "\\b"), to_string(i));
-
-                istringstream iss(unrolledBody);
-                string line;
-                while (getline(iss, line)) {
-                    line = trim(line);
-                    if (line.empty()) continue;
-                    // You can expand this to handle other statement types inside a generate block
-                    if (line.find("assign") != string::npos) {
-                        parseAssignment(line, circuit);
-                    }
-                }
-            }
-        } else {
-            cout << "WARNING: Unsupported for-generate syntax. Skipping." << endl;
-            cout << "Block was: \"" << block << "\"" << endl;
-        }
-    }
-
-    static string rewriteExpressionForBit(const string& expr, const string& baseName, 
-                                         const string& bitSignal, const LogicCircuit& circuit) {
-        string result = expr;
-        size_t pos = 0;
-        
-        while ((pos = result.find(baseName, pos)) != string::npos) {
-            bool beforeOk = (pos == 0) || !isalnum(static_cast<unsigned char>(result[pos-1]));
-            size_t afterPos = pos + baseName.length();
-            bool afterOk = (afterPos >= result.length()) || !isalnum(static_cast<unsigned char>(result[afterPos]));
-            
-            if (beforeOk && afterOk) {
-                result.replace(pos, baseName.length(), bitSignal);
-                pos += bitSignal.length();
+    vector<uint64_t> outputs;
+    auto start = chrono::steady_clock::now();
+    sim.simulate(stimulus, outputs, words);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t lastMask = (patterns % 64 == 0) ? ~0ULL : ((1ULL << (patterns % 64)) - 1);
+    cout << "c Simulated " << patterns << " patterns, " << sim.getInputs().size() << " inputs, "
+         << sim.getOutputs().size() << " outputs, " << sim.getNumInstructions() << " instructions\n";
+    for (size_t o = 0; o < sim.getOutputs().size(); o++) {
+        cout << sim.getOutputs()[o];
+        size_t ones = 0;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t word = outputs[o * words + w];
+            if (w + 1 == words) word &= lastMask;
+            if (stimulusFile.empty()) {
+                ones += __builtin_popcountll(word);
             } else {
-                pos += baseName.length();
+                cout << " " << hex << setw(16) << setfill('0') << word << dec;
             }
         }
-        
-        return result;
+        if (stimulusFile.empty()) cout << " ones=" << ones;
+        cout << "\n";
     }
-
-    static void parseRange(const string& s, int& msb, int& lsb) {
-        size_t lb = s.find('['), rb = s.find(']');
-        string r = s.substr(lb+1, rb-lb-1);
-        size_t colonPos = r.find(':');
-        msb = stoi(r.substr(0, colonPos));
-        lsb = stoi(r.substr(colonPos+1));
+    if (seconds > 0) {
+        cout << "c " << (sim.getNumInstructions() * words * 64 / seconds) << " gate evaluations/s\n";
     }
-
-    static void parseIO(const string& line, unordered_set<string>& container) {
-        string cleaned = line;
-        cleaned.erase(remove_if(cleaned.begin(), cleaned.end(),
-                                [](unsigned char c) { return c == ',' || c == ';'; }),
-                      cleaned.end());
-
-        stringstream ss(cleaned);
-        string word;
-        ss >> word;
-
-        string currentRange = "";
-        
-        while (ss >> word) {
-            if (word[0] == '[') {
-                currentRange = word;
-            } else {
-                if (!currentRange.empty()) {
-                    string rangeClean = currentRange;
-                    rangeClean.erase(remove(rangeClean.begin(), rangeClean.end(), '['), rangeClean.end());
-                    rangeClean.erase(remove(rangeClean.begin(), rangeClean.end(), ']'), rangeClean.end());
-                    
-                    size_t colonPos = rangeClean.find(':');
-                    if (colonPos != string::npos) {
-                        int msb = stoi(rangeClean.substr(0, colonPos));
-                        int lsb = stoi(rangeClean.substr(colonPos + 1));
-                        for (int i = msb; i >= lsb; --i) {
-                            string bit_signal = word + "[" + to_string(i) + "]";
-                            container.insert(bit_signal);
-                        }
-                    } else {
-                        string bit_signal = word + "[" + rangeClean + "]";
-                        container.insert(bit_signal);
-                    }
-                    currentRange = "";
-                } else {
-                    container.insert(word);
-                }
-            }
-        }
+    return 0;
+}
+
+// ---------------- TRUTH TABLES ----------------
+// --truth-tables: per output, the support size, a constant flag, the functional hash and,
+// for supports of at most 8 inputs, the inputs (most significant first) and the table in hex
+static int runTruthTables(const LogicCircuit& circuit) {
+    TruthTableEngine engine(circuit);
+    vector<string> outputs(circuit.outputs.begin(), circuit.outputs.end());
+    sort(outputs.begin(), outputs.end());
+    if (outputs.empty()) outputs = circuit.getOutputs();
+
+    for (const auto& out : outputs) {
+        ConeTable table;
+        cout << out;
+        if (!engine.compute(out, table)) {
+            cout << " support>" << TruthTableEngine::kMaxSupport << "\n";
+            continue;
+        }
+        bool value = false;
+        cout << " support=" << table.support.size();
+        if (table.isConstant(value)) cout << " const=" << value;
+        cout << " hash=" << hex << setw(16) << setfill('0') << table.functionalHash() << dec;
+        if (table.support.size() <= 8) {
+            cout << " inputs=";
+            for (size_t j = table.support.size(); j-- > 0;) {
+                cout << table.support[j] << (j ? "," : "");
+            }
+            cout << " table=";
+            size_t digits = table.support.size() < 2 ? 1 : (size_t(1) << table.support.size()) / 4;
+            for (size_t d = digits; d-- > 0;) {
+                cout << hex << ((table.bits[d / 16] >> (4 * (d % 16))) & 0xf) << dec;
+            }
+        }
+        cout << "\n";
     }
-
-    static void parseAssignment(const string& line, LogicCircuit& circuit) {
-        cout << "DEBUG ASSIGN: Raw line = \"" << line << "\"" << endl;
-        
-        string cleaned = line;
-        cleaned.erase(remove(cleaned.begin(), cleaned.end(), ';'), cleaned.end());
-        
-        size_t pos = cleaned.find("<=");
-        bool isNonBlocking = false;
-        if (pos == string::npos) {
-            pos = cleaned.find('=');
-        } else {
-            isNonBlocking = true;
-        }
-        
-        if (pos == string::npos) {
-            cout << "DEBUG ASSIGN: No assignment operator found, skipping line" << endl;
-            return;
-        }
-
-        string lhs = cleaned.substr(0, pos);
-        string rhs = cleaned.substr(pos + (isNonBlocking ? 2 : 1));
-
-        if (lhs.find("assign") != string::npos) {
-            size_t assignPos = lhs.find("assign");
-            lhs = lhs.substr(assignPos + 6);
-        }
-
-        lhs = trim(lhs);
-        rhs = trim(rhs);
-
-        if (lhs.empty() || rhs.empty()) {
-            return;
-        }
-
-        // KEY FIX: Check if LHS has bracket but determine if it's bit-select or range
-        auto lhsBracketPos = lhs.find('[');
-        bool lhsHasBracket = (lhsBracketPos != string::npos);
-        bool lhsHasColon = (lhsHasBracket && lhs.find(':', lhsBracketPos) != string::npos);
-        
-        // Bit-select: has '[' but NO ':' (e.g., out[0])
-        // Range: has '[' AND ':' (e.g., out[7:0])
-        bool lhsIsBitSelect = lhsHasBracket && !lhsHasColon;
-        bool lhsIsRange = lhsHasBracket && lhsHasColon;
-        
-        // For bit-selects from generate loops, process directly
-        if (lhsIsBitSelect) {
-            cout << "DEBUG ASSIGN: Detected bit-select LHS: " << lhs << endl;
-            int tempCounter = 0;
-            parseExpression(rhs, lhs, circuit, tempCounter);
-            return;
-        }
-
-        auto rhsBracketPos = rhs.find('[');
-        bool rhsHasBracket = (rhsBracketPos != string::npos);
-        bool rhsHasColon = (rhsHasBracket && rhs.find(':', rhsBracketPos) != string::npos);
-        
-        bool rhsIsBitSelect = rhsHasBracket && !rhsHasColon;
-        bool rhsIsRange = rhsHasBracket && rhsHasColon;
-
-        // Handle range-to-range assignment
-        if (lhsIsRange && rhsIsRange) {
-            cout << "DEBUG ASSIGN: Range-to-range assignment" << endl;
-            int lhsMsb, lhsLsb, rhsMsb, rhsLsb;
-            parseRange(lhs, lhsMsb, lhsLsb);
-            parseRange(rhs, rhsMsb, rhsLsb);
-
-            if ((lhsMsb - lhsLsb) != (rhsMsb - rhsLsb)) {
-                throw runtime_error("Vector width mismatch in assignment");
-            }
-
-            int width = lhsMsb - lhsLsb + 1;
-            for (int i = 0; i < width; ++i) {
-                string lhsBit = lhs.substr(0, lhsBracketPos) + "[" + to_string(lhsMsb - i) + "]";
-                string rhsBit = rhs.substr(0, rhsBracketPos) + "[" + to_string(rhsMsb - i) + "]";
-                int tempCounter = 0;
-                parseExpression(rhsBit, lhsBit, circuit, tempCounter);
-            }
-        }
-        else if (isVectorBase(lhs, circuit)) {
-            cout << "DEBUG ASSIGN: Vector base assignment" << endl;
-            vector<string> lhsBits = getVectorBits(lhs, circuit);
-            
-            for (const string& lhsBit : lhsBits) {
-                string rhsBit = rhs;
-                
-                vector<string> vectorBases;
-                for (const auto& in : circuit.inputs) {
-                    size_t bracketPos = in.find('[');
-                    if (bracketPos != string::npos) {
-                        string base = in.substr(0, bracketPos);
-                        if (find(vectorBases.begin(), vectorBases.end(), base) == vectorBases.end()) {
-                            vectorBases.push_back(base);
-                        }
-                    }
-                }
-                
-                string tempRhs = rhsBit;
-                for (const string& base : vectorBases) {
-                    if (isVectorBase(base, circuit)) {
-                        vector<string> baseBits = getVectorBits(base, circuit);
-                        size_t lhsIdx = 0;
-                        for (size_t i = 0; i < lhsBits.size(); i++) {
-                            if (lhsBits[i] == lhsBit) {
-                                lhsIdx = i;
-                                break;
-                            }
-                        }
-                        if (lhsIdx < baseBits.size()) {
-                            tempRhs = rewriteExpressionForBit(tempRhs, base, baseBits[lhsIdx], circuit);
-                        }
-                    }
-                }
-                rhsBit = tempRhs;
-                
-                int tempCounter = 0;
-                parseExpression(rhsBit, lhsBit, circuit, tempCounter);
-            }
-        } else {
-            cout << "DEBUG ASSIGN: Simple assignment" << endl;
-            int tempCounter = 0;
-            parseExpression(rhs, lhs, circuit, tempCounter);
-        }
+    return 0;
+}
+
+// ---------------- BMC ----------------
+// --bmc <frames>: circuit.cnf holds that many frames of the clocked always blocks, written
+// one frame at a time as the unroller produces it. With --outputs, a last clause asks for
+// one of the listed signals to be 1 in some frame (bad states: SAT is a trace of at most
+// <frames> cycles); without, the CNF is the bare unrolling.
+static int runBmc(const LogicCircuit& circuit, const vector<string>& bad, size_t frames, bool zeroInit,
+                  size_t xorCut) {
+    vector<string> roots = bad.empty() ? circuit.getOutputs() : bad;
+    vector<string> keep = roots;
+    for (const auto& latch : circuit.latches) keep.push_back(latch.second);
+    LogicCircuit fused = GateFusion::fuse(circuit, xorCut, keep);
+    Unroller unroller(fused, roots, xorCut);
+
+    size_t clauses = frames * unroller.clausesPerFrame() + (zeroInit ? unroller.latchCount() : 0) + (bad.empty() ? 0 : 1);
+    ofstream out("circuit.cnf");
+    if (!out.is_open()) throw runtime_error("Cannot write circuit.cnf");
+    out << "c BMC unrolling of " << circuit.latches.size() << " latches over " << frames << " frames\n";
+    out << "p cnf " << unroller.numVariables(frames) << " " << clauses << "\n";
+    auto write = [&](const vector<int>& literals) {
+        for (int lit : literals) out << lit << (lit == 0 ? "\n" : " ");
+    };
+    if (zeroInit) write(unroller.zeroInitialState());
+    for (size_t t = 0; t < frames; t++) write(unroller.nextFrame());
+    if (!bad.empty()) {
+        vector<int> property;
+        for (size_t t = 0; t < frames; t++) {
+            for (const auto& name : bad) property.push_back(unroller.literal(name, t));
+        }
+        property.push_back(0);
+        write(property);
     }
-
-// REPLACE the old VerilogParser::parse function with this corrected version.
-public:
-    static LogicCircuit parse(const string& filename) {
-        ifstream file(filename);
-        if (!file.is_open()) {
-            throw runtime_error("Cannot open file");
-        }
-
-        LogicCircuit circuit;
-        string line;
-        while (getline(file, line)) {
-            auto commentPos = line.find("//");
-            if (commentPos != string::npos) {
-                line = line.substr(0, commentPos);
-            }
-            string trimmedLine = trim(line);
-            if (trimmedLine.empty()) continue;
-
-            if (trimmedLine.rfind("module", 0) == 0) continue;
-            if (trimmedLine.rfind("endmodule", 0) == 0) continue;
-            
-            // *** START OF FIX ***
-            // Prioritize block-level statements like generate and always.
-            if (trimmedLine.rfind("generate", 0) == 0) {
-                string block = line;
-                string currentLine;
-                int depth = 1;
-                // Read the entire block until the matching endgenerate
-                while (getline(file, currentLine)) {
-                    block += "\n" + currentLine;
-                    if (currentLine.find("generate") != string::npos) depth++;
-                    if (currentLine.find("endgenerate") != string::npos) depth--;
-                    if (depth == 0) break;
-                }
-                parseGenerateBlock(block, circuit);
-            }
-            else if (trimmedLine.rfind("always", 0) == 0) {
-                string block = readVerilogBlock(file, line);
-                parseAlwaysBlock(block, circuit);
-            }
-            // Only parse these if they are not inside a block being handled above.
-            else if (trimmedLine.rfind("input", 0) == 0) {
-                parseIO(line, circuit.inputs);
-            }
-            else if (trimmedLine.rfind("output", 0) == 0) {
-                parseIO(line, circuit.outputs);
-            }
-            else if (trimmedLine.rfind("reg", 0) == 0) {
-                parseIO(line, circuit.registers);
-            }
-            else if (trimmedLine.rfind("assign", 0) == 0) {
-                parseAssignment(line, circuit);
-            }
-            // *** END OF FIX ***
+    out.close();
+
+    // Ports and latches per frame, for reading a trace back from a model
+    vector<string> named(circuit.inputs.begin(), circuit.inputs.end());
+    named.insert(named.end(), circuit.outputs.begin(), circuit.outputs.end());
+    sort(named.begin(), named.end());
+    named.erase(unique(named.begin(), named.end()), named.end());
+    cout << "c Frame literals (signal@frame -> literal, negative = complemented variable):\n";
+    for (size_t t = 0; t < frames; t++) {
+        for (const auto& name : named) {
+            int lit = unroller.literal(name, t);
+            if (lit != 0 && name[0] != '$') cout << "c " << name << "@" << t << " -> " << lit << "\n";
         }
-        return circuit;
     }
-};
+    cout << "c BMC: " << unroller.latchCount() << " latches, " << unroller.clausesPerFrame() << " clauses and "
+         << unroller.numVariables(1) - static_cast<int>(unroller.latchCount()) << " variables per frame, "
+         << frames << " frames, " << (zeroInit ? "zero" : "free") << " initial state\n";
+    cout << "CNF written to circuit.cnf\n";
+    return 0;
+}
 
 // ---------------- MAIN ----------------
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        cerr << "Usage: ./sat_cnf <verilog_file>\n";
+        cerr << "Usage: ./sat_cnf <verilog_file> [--simulate <stimulus_file> | --simulate-random <patterns> [seed]"
+                " | --truth-tables] [--outputs y1,y2,...] [--xor-cut N] [--emit-sim [file.cpp]]"
+                " [--adder ripple|cla|kogge-stone|brent-kung|sklansky] [--multiplier dadda|wallace]"
+                " [--pp-order row|canonical] [--compare tseitin|direct] [--bmc <frames> [--bmc-init zero|free]]\n";
         return 1;
     }
     string filename = argv[1];
+
+    string stimulusFile;
+    size_t randomPatterns = 0;
+    uint64_t seed = 1;
+    bool truthTables = false;
+    string simSourceFile;
+    vector<string> selectedOutputs;
+    size_t xorCut = 3;
+    size_t bmcFrames = 0;
+    bool zeroInit = true;
+    for (int i = 2; i < argc; i++) {
+        string opt = argv[i];
+        if (opt == "--simulate" && i + 1 < argc) {
+            stimulusFile = argv[++i];
+        } else if (opt == "--simulate-random" && i + 1 < argc) {
+            randomPatterns = strtoull(argv[++i], nullptr, 10);
+            if (i + 1 < argc && argv[i + 1][0] != '-') seed = strtoull(argv[++i], nullptr, 10);
+        } else if (opt == "--emit-sim") {
+            simSourceFile = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "circuit_sim.cpp";
+        } else if (opt == "--outputs" && i + 1 < argc) {
+            stringstream list(argv[++i]);
+            string name;
+            while (getline(list, name, ',')) {
+                if (!name.empty()) selectedOutputs.push_back(name);
+            }
+        } else if (opt == "--xor-cut" && i + 1 < argc) {
+            xorCut = max<size_t>(2, strtoull(argv[++i], nullptr, 10));
+        } else if (opt == "--bmc" && i + 1 < argc) {
+            bmcFrames = strtoull(argv[++i], nullptr, 10);
+            if (bmcFrames == 0) {
+                cerr << "--bmc needs at least one frame\n";
+                return 1;
+            }
+        } else if (opt == "--bmc-init" && i + 1 < argc) {
+            string init = argv[++i];
+            if (init != "zero" && init != "free") {
+                cerr << "Unknown initial state: " << init << "\n";
+                return 1;
+            }
+            zeroInit = init == "zero";
+        } else if (opt == "--truth-tables") {
+            truthTables = true;
+        } else if (opt == "--adder" && i + 1 < argc) {
+            if (!ArithmeticBuilder::parseArchitecture(argv[++i], VerilogParser::adderArchitecture)) {
+                cerr << "Unknown adder architecture: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (opt == "--multiplier" && i + 1 < argc) {
+            if (!ArithmeticBuilder::parseArchitecture(argv[++i], VerilogParser::multiplierArchitecture)) {
+                cerr << "Unknown multiplier architecture: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (opt == "--pp-order" && i + 1 < argc) {
+            string order = argv[++i];
+            if (order != "row" && order != "canonical") {
+                cerr << "Unknown partial-product order: " << order << "\n";
+                return 1;
+            }
+            VerilogParser::canonicalPartialProducts = order == "canonical";
+        } else if (opt == "--compare" && i + 1 < argc) {
+            string mode = argv[++i];
+            if (mode != "tseitin" && mode != "direct") {
+                cerr << "Unknown comparator encoding: " << mode << "\n";
+                return 1;
+            }
+            VerilogParser::directComparators = mode == "direct";
+        } else {
+            cerr << "Unknown option: " << opt << "\n";
+            return 1;
+        }
+    }
+    bool simulate = !stimulusFile.empty() || randomPatterns > 0;
     
     try {
-        LogicCircuit circuit = VerilogParser::parse(filename);
+        VerilogParser::verbose = !simulate && !truthTables;
+        // Simulation, truth tables and the emitted simulator observe every output; otherwise
+        // --outputs narrows what is bit-blasted
+        bool observeAll = simulate || truthTables || !simSourceFile.empty();
+        LogicCircuit circuit = VerilogParser::parse(filename, observeAll ? vector<string>() : selectedOutputs);
 
-        sort(circuit.gates.begin(), circuit.gates.end(), [](const Gate& a, const Gate& b) {
-            return a.output < b.output;
-        });
-        auto last = unique(circuit.gates.begin(), circuit.gates.end(), 
-            [](const Gate& a, const Gate& b) { 
-                return a.output == b.output; 
-            });
-        circuit.gates.erase(last, circuit.gates.end());
+        if (simulate) {
+            return runSimulation(circuit, stimulusFile, randomPatterns, seed);
+        }
+        if (truthTables) {
+            return runTruthTables(circuit);
+        }
 
         cout << "\n=== FINAL CIRCUIT STATE ===" << endl;
         cout << "Inputs (" << circuit.inputs.size() << "): ";
@@ -1287,6 +294,8 @@ int main(int argc, char* argv[]) {
                 case Gate::Type::NOR: cout << "NOR("; break;
                 case Gate::Type::BUF: cout << "BUF("; break;
                 case Gate::Type::MUX: cout << "MUX("; break;
+                case Gate::Type::MAJ: cout << "MAJ("; break;
+                case Gate::Type::EQ: cout << "EQ("; break;
             }
             for (size_t j = 0; j < g.inputs.size(); j++) {
                 if (j > 0) cout << ", ";
@@ -1294,13 +303,32 @@ int main(int argc, char* argv[]) {
             }
             cout << ")" << endl;
         }
+        const Levelization& levels = circuit.levelize();
+        if (levels.cycle.empty()) {
+            cout << "Logic depth: " << levels.depth << endl;
+        } else {
+            cout << "Combinational loop: ";
+            for (const auto& signal : levels.cycle) cout << signal << " -> ";
+            cout << levels.cycle[0] << endl;
+        }
         cout << "==========================\n" << endl;
 
+        if (bmcFrames > 0) {
+            return runBmc(circuit, selectedOutputs, bmcFrames, zeroInit, xorCut);
+        }
+
+        // Fuse single-fanout AND/OR/XOR chains into n-ary gates before encoding
+        LogicCircuit fused = GateFusion::fuse(circuit, xorCut, selectedOutputs);
+        cout << "c Gate fusion: " << circuit.gates.size() << " -> " << fused.gates.size() << " gates\n";
+
         CNFConverter converter;
-        auto cnf = converter.circuitToCNF(circuit);
+        converter.setXorCut(xorCut);
+        // --outputs: encode only the cone of influence of the selected signals
+        auto cnf = selectedOutputs.empty() ? converter.circuitToCNF(fused)
+                                           : converter.circuitToCNF(fused, selectedOutputs);
         auto varMap = converter.getVariableMap();
 
-        cout << "c Variable mapping (signal_name -> variable_number):\n";
+        cout << "c Variable mapping (signal_name -> literal, negative = complemented variable):\n";
         vector<pair<string, int>> sortedVars(varMap.begin(), varMap.end());
         sort(sortedVars.begin(), sortedVars.end());
         for (const auto& kv : sortedVars) {
@@ -1316,7 +344,19 @@ int main(int argc, char* argv[]) {
         }
         out.close();
 
+        cout << "c Arena high-water: ";
+        PhaseArena::report(cout);
+        cout << "\n";
         cout << "CNF written to circuit.cnf\n";
+
+        if (!simSourceFile.empty()) {
+            ofstream sim(simSourceFile);
+            if (!sim.is_open()) throw runtime_error("Cannot write " + simSourceFile);
+            SimulationCodeGenerator::Stats stats = SimulationCodeGenerator::emit(circuit, sim);
+            cout << "Simulation source written to " << simSourceFile << " (" << stats.statements
+                 << " statements in " << stats.functions << " functions, " << stats.sharedSignals
+                 << " shared signals)\n";
+        }
     } catch (const exception& e) {
         cerr << "Error: " << e.what() << endl;
         return 1;
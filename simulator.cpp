@@ -0,0 +1,220 @@
+#include "simulator.h"
+
+// ---------------- LogicSimulator ----------------
+LogicSimulator::LogicSimulator(const LogicCircuit& circuit) {
+    inputNames = circuit.getInputs();
+    outputNames.assign(circuit.outputs.begin(), circuit.outputs.end());
+    std::sort(outputNames.begin(), outputNames.end());
+    if (outputNames.empty()) outputNames = circuit.getOutputs();
+    compile(circuit);
+}
+
+LogicSimulator::LogicSimulator(const LogicCircuit& circuit, const std::vector<std::string>& inputs,
+                               const std::vector<std::string>& outputs)
+    : inputNames(inputs), outputNames(outputs) {
+    compile(circuit);
+}
+
+void LogicSimulator::compile(const LogicCircuit& circuit) {
+    // ---- Slots: primary inputs first, then one per compiled gate ----
+    std::unordered_map<std::string, uint32_t> slotOf;
+    uint32_t numSlots = 0;
+    for (const auto& in : inputNames) slotOf[in] = numSlots++;
+
+    auto emit = [&](Op op, uint32_t dst, uint32_t a, uint32_t b, uint32_t c) {
+        Instr instr = {op, dst * static_cast<uint32_t>(kBlockWords), a * static_cast<uint32_t>(kBlockWords),
+                       b * static_cast<uint32_t>(kBlockWords), c * static_cast<uint32_t>(kBlockWords)};
+        program.push_back(instr);
+    };
+
+    // ---- Only the cone of the outputs is compiled, drivers first ----
+    std::vector<uint32_t> onesSlots;
+    auto slot = [&](const std::string& name) {
+        auto s = slotOf.find(name);
+        if (s != slotOf.end()) return s->second;
+        // undriven signal: a slot that stays 0 (all ones for the constant 1)
+        if (name == LogicCircuit::kConst1) onesSlots.push_back(numSlots);
+        return slotOf[name] = numSlots++;
+    };
+    for (size_t g : circuit.cone(outputNames).gates) {
+        const Gate& gate = circuit.gates[g];
+        const std::string& name = gate.output;
+        // a signal listed as an input is read from the stimulus, not computed
+        if (slotOf.find(name) != slotOf.end()) continue;
+
+        if (gate.inputs.empty()) {
+            throw std::runtime_error("Gate driving " + name + " has no inputs");
+        }
+        std::vector<uint32_t> in;
+        for (const auto& input : gate.inputs) in.push_back(slot(input));
+
+        // BUFs and single-input AND/OR/XOR are plain aliases, no instruction
+        bool alias = gate.type == Gate::Type::BUF ||
+                     (in.size() == 1 && (gate.type == Gate::Type::AND || gate.type == Gate::Type::OR ||
+                                         gate.type == Gate::Type::XOR));
+        if (alias) {
+            slotOf[name] = in[0];
+            continue;
+        }
+
+        uint32_t dst = numSlots++;
+        slotOf[name] = dst;
+        if (gate.type == Gate::Type::NOT) {
+            emit(Op::NOT, dst, in[0], 0, 0);
+            continue;
+        }
+        if (gate.type == Gate::Type::MUX) {
+            if (in.size() != 3) throw std::runtime_error("MUX driving " + name + " needs 3 inputs");
+            emit(Op::MUX, dst, in[0], in[1], in[2]);
+            continue;
+        }
+        if (gate.type == Gate::Type::MAJ) {
+            if (in.size() != 3) throw std::runtime_error("MAJ driving " + name + " needs 3 inputs");
+            emit(Op::MAJ, dst, in[0], in[1], in[2]);
+            continue;
+        }
+        if (gate.type == Gate::Type::EQ) {
+            if (in.size() % 2 != 0) throw std::runtime_error("EQ driving " + name + " needs input pairs");
+            // Pairwise XNORs ANDed into dst through one scratch slot
+            emit(Op::XNOR, dst, in[0], in[1], 0);
+            uint32_t same = in.size() > 2 ? numSlots++ : 0;
+            for (size_t i = 2; i < in.size(); i += 2) {
+                emit(Op::XNOR, same, in[i], in[i + 1], 0);
+                emit(Op::AND, dst, dst, same, 0);
+            }
+            continue;
+        }
+
+        // n-ary gates accumulate into dst, the inversion (if any) happens on the last step
+        Op acc = Op::AND, last = Op::AND;
+        switch (gate.type) {
+            case Gate::Type::AND:  acc = Op::AND; last = Op::AND;  break;
+            case Gate::Type::NAND: acc = Op::AND; last = Op::NAND; break;
+            case Gate::Type::OR:   acc = Op::OR;  last = Op::OR;   break;
+            case Gate::Type::NOR:  acc = Op::OR;  last = Op::NOR;  break;
+            case Gate::Type::XOR:  acc = Op::XOR; last = Op::XOR;  break;
+            case Gate::Type::XNOR: acc = Op::XOR; last = Op::XNOR; break;
+            default: break;
+        }
+        if (in.size() == 1) {
+            // single-input NAND/NOR/XNOR
+            emit(Op::NOT, dst, in[0], 0, 0);
+            continue;
+        }
+        uint32_t src = in[0];
+        for (size_t i = 1; i < in.size(); i++) {
+            emit(i + 1 == in.size() ? last : acc, dst, src, in[i], 0);
+            src = dst;
+        }
+    }
+
+    for (const auto& out : outputNames) outputSlots.push_back(slot(out));
+    values.assign(static_cast<size_t>(numSlots) * kBlockWords, 0);
+    for (uint32_t ones : onesSlots) {
+        std::fill_n(values.begin() + static_cast<size_t>(ones) * kBlockWords, kBlockWords, ~uint64_t(0));
+    }
+}
+
+const std::vector<std::string>& LogicSimulator::getInputs() const {
+    return inputNames;
+}
+
+const std::vector<std::string>& LogicSimulator::getOutputs() const {
+    return outputNames;
+}
+
+size_t LogicSimulator::getNumInstructions() const {
+    return program.size();
+}
+
+void LogicSimulator::run() {
+    uint64_t* v = values.data();
+    for (const Instr& instr : program) {
+        uint64_t* d = v + instr.dst;
+        const uint64_t* a = v + instr.a;
+        const uint64_t* b = v + instr.b;
+        const uint64_t* s = v + instr.c;
+        switch (instr.op) {
+            case Op::NOT:  for (size_t w = 0; w < kBlockWords; w++) d[w] = ~a[w]; break;
+            case Op::AND:  for (size_t w = 0; w < kBlockWords; w++) d[w] = a[w] & b[w]; break;
+            case Op::OR:   for (size_t w = 0; w < kBlockWords; w++) d[w] = a[w] | b[w]; break;
+            case Op::XOR:  for (size_t w = 0; w < kBlockWords; w++) d[w] = a[w] ^ b[w]; break;
+            case Op::NAND: for (size_t w = 0; w < kBlockWords; w++) d[w] = ~(a[w] & b[w]); break;
+            case Op::NOR:  for (size_t w = 0; w < kBlockWords; w++) d[w] = ~(a[w] | b[w]); break;
+            case Op::XNOR: for (size_t w = 0; w < kBlockWords; w++) d[w] = ~(a[w] ^ b[w]); break;
+            case Op::MUX:  for (size_t w = 0; w < kBlockWords; w++) d[w] = (a[w] & ~s[w]) | (b[w] & s[w]); break;
+            case Op::MAJ:  for (size_t w = 0; w < kBlockWords; w++) d[w] = (a[w] & b[w]) | (s[w] & (a[w] | b[w])); break;
+        }
+    }
+}
+
+void LogicSimulator::simulate(const std::vector<uint64_t>& inputs, std::vector<uint64_t>& outputs, size_t words) {
+    if (inputs.size() < inputNames.size() * words) {
+        throw std::runtime_error("Stimulus has fewer words than inputs * words");
+    }
+    outputs.assign(outputNames.size() * words, 0);
+
+    for (size_t base = 0; base < words; base += kBlockWords) {
+        size_t n = std::min(kBlockWords, words - base);
+        for (size_t i = 0; i < inputNames.size(); i++) {
+            uint64_t* slot = values.data() + i * kBlockWords;
+            for (size_t w = 0; w < kBlockWords; w++) {
+                slot[w] = w < n ? inputs[i * words + base + w] : 0;
+            }
+        }
+        run();
+        for (size_t o = 0; o < outputNames.size(); o++) {
+            const uint64_t* slot = values.data() + static_cast<size_t>(outputSlots[o]) * kBlockWords;
+            for (size_t w = 0; w < n; w++) outputs[o * words + base + w] = slot[w];
+        }
+    }
+}
+
+std::vector<uint64_t> LogicSimulator::readStimulus(const std::string& filename, size_t& patterns) const {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open stimulus file " + filename);
+    }
+
+    std::vector<std::string> rows;
+    std::string line;
+    while (std::getline(file, line)) {
+        auto commentPos = line.find('#');
+        if (commentPos != std::string::npos) line = line.substr(0, commentPos);
+        line.erase(std::remove_if(line.begin(), line.end(),
+                                  [](unsigned char c) { return isspace(c) || c == '_'; }),
+                   line.end());
+        if (line.empty()) continue;
+        if (line.size() != inputNames.size()) {
+            throw std::runtime_error("Stimulus pattern \"" + line + "\" has " + std::to_string(line.size()) +
+                                     " bits, expected " + std::to_string(inputNames.size()));
+        }
+        rows.push_back(line);
+    }
+
+    patterns = rows.size();
+    size_t words = (patterns + 63) / 64;
+    std::vector<uint64_t> stimulus(inputNames.size() * words, 0);
+    for (size_t p = 0; p < rows.size(); p++) {
+        for (size_t i = 0; i < inputNames.size(); i++) {
+            char c = rows[p][i];
+            if (c != '0' && c != '1') {
+                throw std::runtime_error("Stimulus pattern \"" + rows[p] + "\" is not binary");
+            }
+            if (c == '1') stimulus[i * words + p / 64] |= 1ULL << (p % 64);
+        }
+    }
+    return stimulus;
+}
+
+std::vector<uint64_t> LogicSimulator::randomStimulus(size_t words, uint64_t seed) const {
+    // splitmix64
+    std::vector<uint64_t> stimulus(inputNames.size() * words);
+    for (auto& word : stimulus) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        word = z ^ (z >> 31);
+    }
+    return stimulus;
+}
@@ -0,0 +1,56 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include "ver2cnf.h"
+#include <cstdint>
+
+// ---------------- LogicSimulator ----------------
+// Bit-parallel simulator for a parsed LogicCircuit. The circuit is levelized once and
+// compiled into a flat instruction array (op, dst, src...). Every pass runs the whole
+// program over one block of 64 * kBlockWords patterns using word-wide bitwise ops; the
+// fixed-width inner loops are what the compiler turns into SIMD.
+class LogicSimulator {
+public:
+    // 8 words = 512 patterns per pass, one cache line per signal
+    static constexpr size_t kBlockWords = 8;
+
+    explicit LogicSimulator(const LogicCircuit& circuit);
+    // Compiles only the cones of `outputs`, with the word arrays in the given port order.
+    // Undriven signals that are not listed in `inputs` evaluate to 0.
+    LogicSimulator(const LogicCircuit& circuit, const std::vector<std::string>& inputs,
+                   const std::vector<std::string>& outputs);
+
+    // Inputs and outputs in the order used by the word arrays below (sorted by name)
+    const std::vector<std::string>& getInputs() const;
+    const std::vector<std::string>& getOutputs() const;
+    size_t getNumInstructions() const;
+
+    // Evaluates 64 * words patterns. Pattern p of input i is bit (p % 64) of
+    // inputs[i * words + p / 64]; outputs are laid out the same way.
+    void simulate(const std::vector<uint64_t>& inputs, std::vector<uint64_t>& outputs, size_t words);
+
+    // Stimulus file: one pattern per line with one 0/1 character per input in getInputs()
+    // order. Blank lines, '_' separators and '#' comments are ignored.
+    std::vector<uint64_t> readStimulus(const std::string& filename, size_t& patterns) const;
+    std::vector<uint64_t> randomStimulus(size_t words, uint64_t seed) const;
+
+private:
+    enum class Op : uint8_t { NOT, AND, OR, XOR, NAND, NOR, XNOR, MUX, MAJ };
+
+    // Operands are offsets into the value block (slot * kBlockWords)
+    struct Instr {
+        Op op;
+        uint32_t dst, a, b, c;
+    };
+
+    std::vector<std::string> inputNames;
+    std::vector<std::string> outputNames;
+    std::vector<uint32_t> outputSlots;
+    std::vector<Instr> program;
+    std::vector<uint64_t> values;
+
+    void compile(const LogicCircuit& circuit);
+    void run();
+};
+
+#endif // SIMULATOR_H
@@ -0,0 +1,28 @@
+// case and if/else chains lowered to mux trees
+module case_if(
+    input [3:0] a,
+    input [3:0] b,
+    input [1:0] op,
+    input en,
+    input sel,
+    output reg [3:0] y,
+    output reg z
+);
+    always @(*) begin
+        case (op)
+            2'b00: y = a & b;
+            2'b01: y = a | b;
+            2'b10: y = a ^ b;
+            default: y = ~a;
+        endcase
+    end
+
+    always @(*) begin
+        if (en)
+            z = a[0] & b[0];
+        else if (sel)
+            z = a[1];
+        else
+            z = b[1];
+    end
+endmodule
@@ -0,0 +1,10 @@
+// Concatenation, replication and part-selects
+module concat(
+    input [7:0] a,
+    input [7:0] b,
+    output [7:0] y,
+    output [7:0] z
+);
+    assign y = {a[3:0], b[7:4]};
+    assign z = {{2{a[1:0]}}, b[3:0]} ^ {4'h0, a[7:4]};
+endmodule
@@ -0,0 +1,17 @@
+// 4-bit counter with synchronous enable and asynchronous reset, for --bmc
+module counter(
+    input clk,
+    input rst,
+    input en,
+    output reg [3:0] q,
+    output wrap
+);
+    always @(posedge clk or posedge rst) begin
+        if (rst)
+            q <= 4'd0;
+        else if (en)
+            q <= q + 4'd1;
+    end
+
+    assign wrap = q == 4'd15;
+endmodule
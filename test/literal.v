@@ -0,0 +1,15 @@
+// Sized literals in binary, hex and decimal, folded while the gates are built
+module literal(
+    input [3:0] a,
+    input c,
+    input en,
+    output y1,
+    output y2,
+    output [3:0] y3,
+    output y4
+);
+    assign y1 = c & 1'b0;
+    assign y2 = c ^ 1'b1;
+    assign y3 = (a & 4'b1010) | 4'h1;
+    assign y4 = (a == 4'd5) & en;
+endmodule
@@ -0,0 +1,18 @@
+// Reduction operators and their negations
+module reduction(
+    input [7:0] a,
+    input [3:0] b,
+    output y_and,
+    output y_or,
+    output y_xor,
+    output y_nand,
+    output y_nor,
+    output y_xnor
+);
+    assign y_and = &a;
+    assign y_or = |a;
+    assign y_xor = ^a;
+    assign y_nand = ~&b;
+    assign y_nor = ~|b;
+    assign y_xnor = ~^b;
+endmodule
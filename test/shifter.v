@@ -0,0 +1,14 @@
+// Barrel shifters by a variable amount, plus constant shifts
+module shifter(
+    input [3:0] a,
+    input [2:0] s,
+    output [3:0] l,
+    output [3:0] r,
+    output [3:0] l1,
+    output [3:0] r2
+);
+    assign l = a << s;
+    assign r = a >> s;
+    assign l1 = a << 1;
+    assign r2 = a >> 2;
+endmodule
@@ -0,0 +1,11 @@
+module wire_vector(a, b, c, y, z);
+input [7:0] a;
+input [7:0] b;
+input c;
+output y;
+output [7:0] z;
+wire [7:0] t;
+assign t = a * b;
+assign y = t[3] & c;
+assign z = t + a;
+endmodule
@@ -0,0 +1,106 @@
+#include "truth_table.h"
+#include "simulator.h"
+
+// ---------------- ConeTable ----------------
+bool ConeTable::isConstant(bool& value) const {
+    uint64_t mask = support.size() < 6 ? (1ULL << (1u << support.size())) - 1 : ~0ULL;
+    bool allZero = true, allOne = true;
+    for (uint64_t word : bits) {
+        allZero = allZero && (word & mask) == 0;
+        allOne = allOne && (word & mask) == mask;
+    }
+    value = allOne;
+    return allZero || allOne;
+}
+
+uint64_t ConeTable::functionalHash() const {
+    // FNV-1a over the support names and the table words
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](uint64_t x) {
+        for (int i = 0; i < 8; i++) {
+            h ^= (x >> (8 * i)) & 0xff;
+            h *= 0x100000001b3ULL;
+        }
+    };
+    for (const auto& name : support) {
+        for (unsigned char c : name) mix(c);
+        mix(0xff);
+    }
+    for (uint64_t word : bits) mix(word);
+    return h;
+}
+
+// ---------------- TruthTableEngine ----------------
+TruthTableEngine::TruthTableEngine(const LogicCircuit& circuit) : circuit(circuit) {}
+
+bool TruthTableEngine::getSupport(const std::string& signal, std::vector<std::string>& support, size_t limit) const {
+    support.clear();
+    Cone cone = circuit.cone({signal});
+    for (auto& leaf : cone.leaves) {
+        // the constant nets are not variables of the cone
+        if (leaf == LogicCircuit::kConst0 || leaf == LogicCircuit::kConst1) continue;
+        support.push_back(std::move(leaf));
+    }
+    return support.size() <= limit;
+}
+
+ConeTable TruthTableEngine::compute(const std::string& signal, const std::vector<std::string>& support) const {
+    size_t k = support.size();
+    size_t words = k < 6 ? 1 : (size_t(1) << (k - 6));
+
+    // Projection functions: variable j is 1 in minterm m iff bit j of m is set
+    static const uint64_t projection[6] = {
+        0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL,
+    };
+    std::vector<uint64_t> stimulus(k * words);
+    for (size_t j = 0; j < k; j++) {
+        for (size_t w = 0; w < words; w++) {
+            // a constant net in a caller's support is tied, as the simulator ties undriven ones
+            stimulus[j * words + w] = support[j] == LogicCircuit::kConst0 ? 0
+                                    : support[j] == LogicCircuit::kConst1 ? ~0ULL
+                                    : j < 6 ? projection[j] : (((w >> (j - 6)) & 1) ? ~0ULL : 0);
+        }
+    }
+
+    LogicSimulator sim(circuit, support, {signal});
+    ConeTable table;
+    table.output = signal;
+    table.support = support;
+    sim.simulate(stimulus, table.bits, words);
+    if (k < 6) table.bits[0] &= (1ULL << (1u << k)) - 1;
+    return table;
+}
+
+bool TruthTableEngine::compute(const std::string& signal, ConeTable& table, size_t limit) const {
+    std::vector<std::string> support;
+    if (!getSupport(signal, support, limit)) return false;
+    table = compute(signal, support);
+    return true;
+}
+
+bool TruthTableEngine::decideEquivalence(const TruthTableEngine& e1, const std::string& out1,
+                                         const TruthTableEngine& e2, const std::string& out2,
+                                         bool& equal, std::vector<std::pair<std::string, bool>>& counterexample,
+                                         size_t limit) {
+    std::vector<std::string> s1, s2, joint;
+    if (!e1.getSupport(out1, s1, limit) || !e2.getSupport(out2, s2, limit)) return false;
+    std::set_union(s1.begin(), s1.end(), s2.begin(), s2.end(), std::back_inserter(joint));
+    if (joint.size() > limit) return false;
+
+    ConeTable t1 = e1.compute(out1, joint);
+    ConeTable t2 = e2.compute(out2, joint);
+    equal = true;
+    counterexample.clear();
+    for (size_t w = 0; w < t1.bits.size(); w++) {
+        uint64_t diff = t1.bits[w] ^ t2.bits[w];
+        if (diff == 0) continue;
+        equal = false;
+        size_t minterm = w * 64 + static_cast<size_t>(__builtin_ctzll(diff));
+        for (size_t j = 0; j < joint.size(); j++) {
+            counterexample.push_back({joint[j], ((minterm >> j) & 1) != 0});
+        }
+        break;
+    }
+    return true;
+}
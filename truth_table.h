@@ -0,0 +1,53 @@
+#ifndef TRUTH_TABLE_H
+#define TRUTH_TABLE_H
+
+#include "ver2cnf.h"
+#include <cstdint>
+
+// ---------------- ConeTable ----------------
+// Complete truth table of one output cone. Minterm m assigns bit j of m to support[j];
+// the function value for m is bit (m % 64) of bits[m / 64]. Tables with fewer than 6
+// support variables use one word with the unused high bits cleared.
+struct ConeTable {
+    std::string output;
+    std::vector<std::string> support;
+    std::vector<uint64_t> bits;
+
+    // True when the function is constant; `value` receives the constant
+    bool isConstant(bool& value) const;
+    // Hash of the function over its named support (equal functions hash equal)
+    uint64_t functionalHash() const;
+};
+
+// ---------------- TruthTableEngine ----------------
+// Exhaustive evaluation of small-support cones without any CNF. A cone is compiled by
+// LogicSimulator and driven with the projection functions of its support, so one pass
+// over 2^k / 64 words yields the whole table.
+class TruthTableEngine {
+public:
+    static constexpr size_t kMaxSupport = 20;
+
+    explicit TruthTableEngine(const LogicCircuit& circuit);
+
+    // Sorted primary inputs in the fanin cone of `signal`. Returns false when the
+    // support exceeds `limit`.
+    bool getSupport(const std::string& signal, std::vector<std::string>& support, size_t limit = kMaxSupport) const;
+
+    // Table of `signal` over `support`, which must cover the cone's own support
+    ConeTable compute(const std::string& signal, const std::vector<std::string>& support) const;
+    // Table over the cone's own support; returns false when it exceeds `limit`
+    bool compute(const std::string& signal, ConeTable& table, size_t limit = kMaxSupport) const;
+
+    // Decides out1 (in e1) == out2 (in e2) when their joint support fits in `limit`.
+    // Returns false if undecided; otherwise `equal` holds the answer and, when the
+    // functions differ, `counterexample` holds one distinguishing input assignment.
+    static bool decideEquivalence(const TruthTableEngine& e1, const std::string& out1,
+                                  const TruthTableEngine& e2, const std::string& out2,
+                                  bool& equal, std::vector<std::pair<std::string, bool>>& counterexample,
+                                  size_t limit = kMaxSupport);
+
+private:
+    const LogicCircuit& circuit;
+};
+
+#endif // TRUTH_TABLE_H
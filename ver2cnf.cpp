@@ -1,42 +1,395 @@
 #include "ver2cnf.h"
+#include "arithmetic.h"
+#include "wordlevel.h"
+#include <regex>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
 
 // ---------------- LogicCircuit ----------------
-void LogicCircuit::addGate(const Gate& gate) {
-    gates.push_back(gate);
+const std::string LogicCircuit::kConst0 = "1'b0";
+const std::string LogicCircuit::kConst1 = "1'b1";
+
+size_t LogicCircuit::GateKeyHash::operator()(const GateKey& key) const {
+    size_t h = static_cast<size_t>(key.type);
+    for (int id : key.fanin) h = h * 1000003u ^ static_cast<size_t>(id);
+    return h;
+}
+
+int LogicCircuit::signalId(const std::string& signal) {
+    auto it = signalIds.emplace(canonical(signal), static_cast<int>(signalIds.size()));
+    return it.first->second;
+}
+
+const std::string& LogicCircuit::canonical(const std::string& signal) const {
+    const std::string* name = &signal;
+    for (auto it = aliases.find(*name); it != aliases.end(); it = aliases.find(*name)) {
+        name = &it->second;
+    }
+    return *name;
+}
+
+namespace {
+
+bool isConstantNet(const std::string& signal, bool& value) {
+    value = signal == LogicCircuit::kConst1;
+    return value || signal == LogicCircuit::kConst0;
+}
+
+const std::string& constantNet(bool value) { return value ? LogicCircuit::kConst1 : LogicCircuit::kConst0; }
+
+// Inputs without duplicates (first occurrence kept), or, with `cancel`, without the
+// signals that occur an even number of times
+std::vector<std::string> distinctInputs(const std::vector<std::string>& inputs, bool cancel) {
+    std::unordered_map<std::string, size_t> count;
+    for (const auto& in : inputs) count[in]++;
+    std::vector<std::string> result;
+    for (const auto& in : inputs) {
+        size_t& n = count[in];
+        if (n > 0 && (!cancel || n % 2 == 1)) result.push_back(in);
+        n = 0;
+    }
+    return result;
+}
+
+} // namespace
+
+Gate LogicCircuit::simplify(const Gate& gate) {
+    const std::string& out = gate.output;
+    const std::vector<std::string>& in = gate.inputs;
+    bool value;
+    if (in.empty()) return gate;
+    switch (gate.type) {
+        case Gate::Type::BUF:
+            return gate;
+        case Gate::Type::NOT:
+            if (isConstantNet(in[0], value)) return Gate(Gate::Type::BUF, {constantNet(!value)}, out);
+            return gate;
+        case Gate::Type::AND: case Gate::Type::NAND: case Gate::Type::OR: case Gate::Type::NOR: {
+            bool isOr = gate.type == Gate::Type::OR || gate.type == Gate::Type::NOR;
+            bool invert = gate.type == Gate::Type::NAND || gate.type == Gate::Type::NOR;
+            std::vector<std::string> kept;
+            for (const auto& signal : in) {
+                if (!isConstantNet(signal, value)) kept.push_back(signal);
+                else if (value == isOr) return Gate(Gate::Type::BUF, {constantNet(isOr != invert)}, out);
+            }
+            kept = distinctInputs(kept, false);
+            if (kept.empty()) return Gate(Gate::Type::BUF, {constantNet(!isOr != invert)}, out);
+            if (kept.size() == 1) return Gate(invert ? Gate::Type::NOT : Gate::Type::BUF, kept, out);
+            return kept.size() == in.size() ? gate : Gate(gate.type, kept, out);
+        }
+        case Gate::Type::XOR: case Gate::Type::XNOR: {
+            bool invert = gate.type == Gate::Type::XNOR;
+            std::vector<std::string> kept;
+            for (const auto& signal : in) {
+                if (isConstantNet(signal, value)) invert = invert != value;
+                else kept.push_back(signal);
+            }
+            kept = distinctInputs(kept, true);
+            if (kept.empty()) return Gate(Gate::Type::BUF, {constantNet(invert)}, out);
+            if (kept.size() == 1) return Gate(invert ? Gate::Type::NOT : Gate::Type::BUF, kept, out);
+            Gate::Type type = invert ? Gate::Type::XNOR : Gate::Type::XOR;
+            return type == gate.type && kept.size() == in.size() ? gate : Gate(type, kept, out);
+        }
+        case Gate::Type::MUX: {
+            if (in.size() != 3) return gate;
+            const std::string &a = in[0], &b = in[1], &sel = in[2];
+            if (isConstantNet(sel, value)) return Gate(Gate::Type::BUF, {value ? b : a}, out);
+            if (a == b) return Gate(Gate::Type::BUF, {a}, out);
+            bool valueA, valueB;
+            bool constantA = isConstantNet(a, valueA), constantB = isConstantNet(b, valueB);
+            if (constantA && constantB) return Gate(valueB ? Gate::Type::BUF : Gate::Type::NOT, {sel}, out);
+            // sel ? b : 0 and sel ? 1 : a are a single AND / OR
+            if ((constantA && !valueA) || a == sel) return Gate(Gate::Type::AND, {sel, b}, out);
+            if ((constantB && valueB) || b == sel) return Gate(Gate::Type::OR, {sel, a}, out);
+            return gate;
+        }
+        case Gate::Type::MAJ: {
+            if (in.size() != 3) return gate;
+            for (size_t i = 0; i < 3; i++) {
+                // MAJ(0, x, y) = x & y, MAJ(1, x, y) = x | y, MAJ(x, x, y) = x
+                const std::string& x = in[(i + 1) % 3];
+                const std::string& y = in[(i + 2) % 3];
+                if (isConstantNet(in[i], value)) {
+                    return simplify(Gate(value ? Gate::Type::OR : Gate::Type::AND, {x, y}, out));
+                }
+                if (x == y) return Gate(Gate::Type::BUF, {x}, out);
+            }
+            return gate;
+        }
+        case Gate::Type::EQ: {
+            if (in.size() % 2 != 0) return gate;
+            std::vector<std::string> kept;
+            for (size_t i = 0; i + 1 < in.size(); i += 2) {
+                bool valueB;
+                if (in[i] == in[i + 1]) continue;
+                if (isConstantNet(in[i], value) && isConstantNet(in[i + 1], valueB)) {
+                    if (value != valueB) return Gate(Gate::Type::BUF, {kConst0}, out);
+                    continue;
+                }
+                kept.push_back(in[i]);
+                kept.push_back(in[i + 1]);
+            }
+            if (kept.empty()) return Gate(Gate::Type::BUF, {kConst1}, out);
+            // One pair is an XNOR
+            if (kept.size() == 2) return simplify(Gate(Gate::Type::XNOR, kept, out));
+            return kept.size() == in.size() ? gate : Gate(gate.type, kept, out);
+        }
+    }
+    return gate;
+}
+
+void LogicCircuit::addGate(const Gate& original) {
+    Gate gate = original;
+    for (auto& in : gate.inputs) {
+        const std::string& signal = canonical(in);
+        if (signal == kConst0 || signal == kConst1) in = signal;
+    }
+    gate = simplify(gate);
+
+    GateKey key = {gate.type, {}};
+    for (const auto& in : gate.inputs) key.fanin.push_back(signalId(in));
+    switch (gate.type) {
+        case Gate::Type::AND: case Gate::Type::OR: case Gate::Type::XOR:
+        case Gate::Type::NAND: case Gate::Type::NOR: case Gate::Type::XNOR: case Gate::Type::MAJ:
+            std::sort(key.fanin.begin(), key.fanin.end());
+            break;
+        case Gate::Type::EQ: {
+            // Commutative within each pair and across pairs
+            std::vector<std::pair<int, int>> pairs;
+            for (size_t i = 0; i + 1 < key.fanin.size(); i += 2) {
+                pairs.push_back(std::minmax(key.fanin[i], key.fanin[i + 1]));
+            }
+            std::sort(pairs.begin(), pairs.end());
+            for (size_t i = 0; i < pairs.size(); i++) {
+                key.fanin[2 * i] = pairs[i].first;
+                key.fanin[2 * i + 1] = pairs[i].second;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    auto hit = gateTable.find(key);
+    auto driven = driverKey.find(gate.output);
+    if (driven != driverKey.end()) {
+        if (driven->second == key || (hit != gateTable.end() && canonical(gate.output) == canonical(hit->second))) {
+            return;
+        }
+        throw std::runtime_error("Multiple drivers for signal " + gate.output);
+    }
+    driverKey.emplace(gate.output, key);
+
+    if (hit != gateTable.end() && hit->second != gate.output) {
+        // Same function as an existing gate: drive this name from it instead (a BUF keeps
+        // its own source, so constants stay visible as constants)
+        const std::string& source = gate.type == Gate::Type::BUF ? gate.inputs[0] : hit->second;
+        aliases[gate.output] = source;
+        gates.push_back(Gate(Gate::Type::BUF, {source}, gate.output));
+    } else {
+        gateTable.emplace(key, gate.output);
+        gates.push_back(gate);
+        // A BUF is the identity: its output is another name for the input
+        if (gate.type == Gate::Type::BUF && canonical(gate.inputs[0]) != gate.output) {
+            aliases[gate.output] = gate.inputs[0];
+        }
+    }
+    // ---- Fanout index: read counts, sinks and undriven signals ----
+    driverIndex.emplace(gate.output, gates.size() - 1);
+    undriven.erase(gate.output);
+    auto read = readCount.find(gate.output);
+    bool outputWasRead = read != readCount.end() && read->second > 0;
+    if (!outputWasRead) sinks.insert(gate.output);
+    for (const auto& in : gate.inputs) {
+        if (readCount[in]++ == 0) sinks.erase(in);
+        if (driverIndex.find(in) == driverIndex.end() && in != kConst0 && in != kConst1) undriven.insert(in);
+    }
+    updateLevels(gates.size() - 1, outputWasRead);
+
     wires.insert(gate.output);
     for (const auto& in : gate.inputs) {
-        if (wires.find(in) == wires.end()) {
+        if (wires.find(in) == wires.end() && in != kConst0 && in != kConst1) {
             inputs.insert(in);
         }
         wires.insert(in);
     }
 }
 
+std::string LogicCircuit::newTemp() {
+    return "$" + std::to_string(tempCount++);
+}
+
 std::vector<std::string> LogicCircuit::getOutputs() const {
-    std::unordered_set<std::string> allInputs;
-    for (const auto& gate : gates) {
-        for (const auto& in : gate.inputs) {
-            allInputs.insert(in);
+    std::vector<std::string> result;
+    for (const auto& sink : sinks) {
+        if (sink[0] != '$') result.push_back(sink);
+    }
+    for (const auto& out : outputs) {
+        if (sinks.find(out) == sinks.end()) result.push_back(out);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+const std::unordered_set<std::string>& LogicCircuit::getSinks() const {
+    return sinks;
+}
+
+const std::unordered_set<std::string>& LogicCircuit::getUndriven() const {
+    return undriven;
+}
+
+bool LogicCircuit::isDriven(const std::string& signal) const {
+    return driverIndex.find(signal) != driverIndex.end();
+}
+
+size_t LogicCircuit::getFanout(const std::string& signal) const {
+    auto it = readCount.find(signal);
+    return it == readCount.end() ? 0 : it->second;
+}
+
+void LogicCircuit::updateLevels(size_t g, bool outputWasRead) {
+    const Gate& gate = gates[g];
+    bool extend = levelsValid && levels.cycle.empty() && !outputWasRead;
+    for (const auto& in : gate.inputs) {
+        extend = extend && in != gate.output;
+    }
+    if (!extend) {
+        levelsValid = false;
+        return;
+    }
+
+    // Nothing reads the new output yet, so no existing level changes
+    int level = 1;
+    for (const auto& in : gate.inputs) {
+        auto d = driverIndex.find(in);
+        if (d == driverIndex.end()) continue;
+        levels.fanout[d->second]++;
+        level = std::max(level, levels.level[d->second] + 1);
+    }
+    levels.order.push_back(g);
+    levels.level.push_back(level);
+    levels.fanout.push_back(0);
+    levels.depth = std::max(levels.depth, level);
+}
+
+const Levelization& LogicCircuit::levelize() const {
+    if (levelsValid && levels.level.size() == gates.size()) return levels;
+
+    // Kahn's algorithm over gate indices
+    size_t n = gates.size();
+    Levelization result;
+    result.level.assign(n, -1);
+    result.fanout.assign(n, 0);
+    // Adjacency scratch is dropped with the arena in one go
+    PhaseArena arena(PhaseArena::CIRCUIT);
+    std::pmr::vector<std::pmr::vector<size_t>> readers(n, arena.resource());
+    std::pmr::vector<std::pmr::vector<size_t>> drivers(n, arena.resource());
+    std::pmr::vector<size_t> pending(n, 0, arena.resource());
+    for (size_t g = 0; g < n; g++) {
+        for (const auto& in : gates[g].inputs) {
+            auto d = driverIndex.find(in);
+            if (d == driverIndex.end()) continue;
+            readers[d->second].push_back(g);
+            drivers[g].push_back(d->second);
+            result.fanout[d->second]++;
+            pending[g]++;
+        }
+    }
+    for (size_t g = 0; g < n; g++) {
+        if (pending[g] == 0) {
+            result.order.push_back(g);
+            result.level[g] = 1;
+        }
+    }
+    for (size_t head = 0; head < result.order.size(); head++) {
+        size_t g = result.order[head];
+        result.depth = std::max(result.depth, result.level[g]);
+        for (size_t r : readers[g]) {
+            if (--pending[r] > 0) continue;
+            int level = 0;
+            for (size_t d : drivers[r]) level = std::max(level, result.level[d]);
+            result.level[r] = level + 1;
+            result.order.push_back(r);
         }
     }
 
-    std::vector<std::string> result;
-    for (const auto& wire : wires) {
-        if (allInputs.find(wire) == allInputs.end()) {
-            result.push_back(wire);
+    // ---- Loop diagnostics: walk back through unresolved drivers until a gate repeats ----
+    if (result.order.size() < n) {
+        size_t g = 0;
+        while (pending[g] == 0) g++;
+        std::unordered_map<size_t, size_t> seenAt;
+        std::vector<size_t> path;
+        while (seenAt.emplace(g, path.size()).second) {
+            path.push_back(g);
+            for (size_t d : drivers[g]) {
+                if (pending[d] > 0) {
+                    g = d;
+                    break;
+                }
+            }
         }
+        for (size_t i = path.size(); i-- > seenAt[g];) result.cycle.push_back(gates[path[i]].output);
     }
 
-    for (const auto& out : outputs) {
-        if (std::find(result.begin(), result.end(), out) == result.end()) {
-            result.push_back(out);
+    levels = result;
+    levelsValid = true;
+    return levels;
+}
+
+Cone LogicCircuit::cone(const std::vector<std::string>& roots, std::vector<char>* done) const {
+    const Levelization& levels = levelize();
+    std::vector<char> visited;
+    if (!done) done = &visited;
+    done->resize(gates.size(), 0);
+
+    Cone result;
+    std::unordered_set<std::string> leaves;
+    std::vector<const std::string*> stack;
+    for (const auto& root : roots) stack.push_back(&root);
+    while (!stack.empty()) {
+        const std::string& signal = *stack.back();
+        stack.pop_back();
+        size_t g = driverOf(signal);
+        if (g == gates.size()) {
+            leaves.insert(signal);
+            continue;
         }
+        if ((*done)[g]) continue;
+        (*done)[g] = 1;
+        result.gates.push_back(g);
+        for (const auto& in : gates[g].inputs) stack.push_back(&in);
     }
 
-    std::sort(result.begin(), result.end());
+    for (size_t g : result.gates) {
+        if (levels.level[g] >= 0) continue;
+        // Unleveled: on or behind a loop, so follow unleveled drivers until a gate repeats
+        std::unordered_set<size_t> seen;
+        while (seen.insert(g).second) {
+            for (const auto& in : gates[g].inputs) {
+                size_t d = driverOf(in);
+                if (d < gates.size() && levels.level[d] < 0) {
+                    g = d;
+                    break;
+                }
+            }
+        }
+        throw std::runtime_error("Combinational loop through " + gates[g].output);
+    }
+    std::sort(result.gates.begin(), result.gates.end(), [&levels](size_t a, size_t b) {
+        return levels.level[a] != levels.level[b] ? levels.level[a] < levels.level[b] : a < b;
+    });
+    result.leaves.assign(leaves.begin(), leaves.end());
+    std::sort(result.leaves.begin(), result.leaves.end());
     return result;
 }
 
+size_t LogicCircuit::driverOf(const std::string& signal) const {
+    auto d = driverIndex.find(signal);
+    return d == driverIndex.end() ? gates.size() : d->second;
+}
+
 std::vector<std::string> LogicCircuit::getInputs() const {
     std::vector<std::string> result(inputs.begin(), inputs.end());
     std::sort(result.begin(), result.end());
@@ -44,138 +397,283 @@ std::vector<std::string> LogicCircuit::getInputs() const {
 }
 
 // ---------------- CNFConverter ----------------
-CNFConverter::CNFConverter() : variableCounter(0) {}
+CNFConverter::CNFConverter() : variableCounter(0), constantVariable(0), xorCut(3) {}
 
-int CNFConverter::getVariable(const std::string& name) {
-    if (variableMap.find(name) == variableMap.end()) {
-        variableCounter++;
-        variableMap[name] = variableCounter;
-    }
-    return variableMap[name];
+void CNFConverter::setXorCut(size_t cut) {
+    xorCut = std::max<size_t>(cut, 2);
+}
+
+int CNFConverter::newVariable() {
+    return ++variableCounter;
 }
 
 void CNFConverter::resetVariables() {
     variableCounter = 0;
+    constantVariable = 0;
     variableMap.clear();
 }
 
-std::vector<std::vector<int>> CNFConverter::gateToCNF(const Gate& gate) {
-    std::vector<std::vector<int>> clauses;
-    int outputVar = getVariable(gate.output);
-    std::vector<int> inputVars;
-    for (const auto& in : gate.inputs) {
-        inputVars.push_back(getVariable(in));
-    }
-
-    // Standard CNF encodings for boolean gates: out <-> f(inputs)
-    if (gate.type == Gate::Type::AND) {
-        // out -> each input true: (-out v in_i)
-        for (int inpVar : inputVars) {
-            clauses.push_back({-outputVar, inpVar});
-        }
-        // all inputs true -> out: (-in1 v -in2 v ... v out)
-        std::vector<int> clause = {outputVar};
-        for (int inpVar : inputVars) {
-            clause.push_back(-inpVar);
-        }
-        clauses.push_back(clause);
-    }
-    else if (gate.type == Gate::Type::OR) {
-        // out -> at least one input true: (-out v in1 v in2 ...)
-        {
-            std::vector<int> clause = {-outputVar};
-            clause.insert(clause.end(), inputVars.begin(), inputVars.end());
-            clauses.push_back(clause);
-        }
-        // each input -> out: (-in_i v out)
-        for (int inpVar : inputVars) {
-            clauses.push_back({-inpVar, outputVar});
-        }
-    }
-    else if (gate.type == Gate::Type::NOT) {
-        int inpVar = inputVars[0];
-        // out <-> ~in  => (-out v -in) & (out v in)
-        clauses.push_back({-outputVar, -inpVar});
-        clauses.push_back({outputVar, inpVar});
-    }
-    else if (gate.type == Gate::Type::XOR) {
-        // two-input XOR truth table CNF (out = a xor b)
-        int a = inputVars[0];
-        int b = inputVars[1];
-        clauses.push_back({-a, -b, -outputVar});
-        clauses.push_back({a, b, -outputVar});
-        clauses.push_back({a, -b, outputVar});
-        clauses.push_back({-a, b, outputVar});
-    }
-    else if (gate.type == Gate::Type::XNOR) {
-        // two-input XNOR (out = a xnor b)
-        int a = inputVars[0];
-        int b = inputVars[1];
-        clauses.push_back({a, b, -outputVar});
-        clauses.push_back({-a, -b, -outputVar});
-        clauses.push_back({-a, b, outputVar});
-        clauses.push_back({a, -b, outputVar});
-    }
-    else if (gate.type == Gate::Type::NAND) {
-        // out <-> !(a & b)  <=> out <-> (¬a ∨ ¬b)
-        // Encoded as:
-        // (a ∧ b) -> ¬out   => (-a ∨ -b ∨ -out)
-        // ¬out -> a         => (out ∨ a)
-        // ¬out -> b         => (out ∨ b)
-        int a = inputVars[0];
-        int b = inputVars[1];
-        clauses.push_back({-a, -b, -outputVar});
-        clauses.push_back({outputVar, a});
-        clauses.push_back({outputVar, b});
-    }
-    else if (gate.type == Gate::Type::NOR) {
-        // out <-> !(a ∨ b)  <=> out <-> (¬a ∧ ¬b)
-        // Encoded as:
-        // out -> ¬a         => (-out ∨ -a)
-        // out -> ¬b         => (-out ∨ -b)
-        // (¬a ∧ ¬b) -> out  => (a ∨ b ∨ out)
-        int a = inputVars[0];
-        int b = inputVars[1];
-        clauses.push_back({-outputVar, -a});
-        clauses.push_back({-outputVar, -b});
-        clauses.push_back({a, b, outputVar});
-    }
-    else if (gate.type == Gate::Type::MUX) {
-        // 3-input MUX: out = sel ? b : a
-        // inputs: a, b, sel (we assume this order in your parser)
-        int a = inputVars[0];
-        int b = inputVars[1];
-        int sel = inputVars[2];
-        // Implementation (common CNF encoding):
-        // sel=0 -> out = a  => (-sel v -a v out) & (-sel v a v -out)
-        // sel=1 -> out = b  => ( sel v -b v out) & ( sel v b v -out)
-        clauses.push_back({-sel, -a, outputVar});
-        clauses.push_back({-sel, a, -outputVar});
-        clauses.push_back({sel, -b, outputVar});
-        clauses.push_back({sel, b, -outputVar});
-    } else if (gate.type == Gate::Type::BUF) {
-        // out <-> in
-        int in = inputVars[0];
-        clauses.push_back({-outputVar, in});  // out -> in  == (-out v in)
-        clauses.push_back({-in, outputVar});  // in -> out  == (-in v out)
+int CNFConverter::constant(bool value, ClauseList& clauses) {
+    if (constantVariable == 0) {
+        constantVariable = newVariable();
+        clauses.add({constantVariable});
     }
+    return value ? constantVariable : -constantVariable;
+}
 
-    return clauses;
+bool CNFConverter::isConstant(int lit, bool& value) const {
+    if (constantVariable == 0 || std::abs(lit) != constantVariable) return false;
+    value = lit > 0;
+    return true;
 }
 
-std::vector<std::vector<int>> CNFConverter::circuitToCNF(const LogicCircuit& circuit) {
-    resetVariables();
-    std::vector<std::vector<int>> clauses;
+int CNFConverter::encodeAnd(const Literals& lits, ClauseList& clauses) {
+    // Drop true inputs, fold on a false input, x & x = x, x & ~x = 0
+    bool value;
+    Literals in(scratch);
+    for (int lit : lits) {
+        if (isConstant(lit, value)) {
+            if (!value) return lit;
+            continue;
+        }
+        in.push_back(lit);
+    }
+    std::sort(in.begin(), in.end(), [](int a, int b) {
+        return std::abs(a) != std::abs(b) ? std::abs(a) < std::abs(b) : a < b;
+    });
+    in.erase(std::unique(in.begin(), in.end()), in.end());
+    for (size_t i = 1; i < in.size(); i++) {
+        if (in[i] == -in[i - 1]) return constant(false, clauses);
+    }
+    if (in.empty()) return constant(true, clauses);
+    if (in.size() == 1) return in[0];
 
-    // Ensure all wires have variables assigned (inputs/outputs/temps)
-    for (const auto& wire : circuit.wires) {
-        getVariable(wire);
+    int out = newVariable();
+    // out -> each input true: (-out v in_i)
+    for (int lit : in) {
+        clauses.add({-out, lit});
+    }
+    // all inputs true -> out: (-in1 v -in2 v ... v out)
+    clauses.addLiteral(out);
+    for (int lit : in) {
+        clauses.addLiteral(-lit);
+    }
+    clauses.endClause();
+    return out;
+}
+
+int CNFConverter::encodeXor(const Literals& lits, ClauseList& clauses) {
+    // Constants and complements move into a parity bit, equal pairs cancel
+    bool parity = false, value;
+    Literals in(scratch);
+    for (int lit : lits) {
+        if (isConstant(lit, value)) {
+            parity ^= value;
+            continue;
+        }
+        if (lit < 0) {
+            parity = !parity;
+            lit = -lit;
+        }
+        in.push_back(lit);
+    }
+    std::sort(in.begin(), in.end());
+    Literals odd(scratch);
+    for (size_t i = 0; i < in.size(); i++) {
+        if (i + 1 < in.size() && in[i] == in[i + 1]) {
+            i++;
+            continue;
+        }
+        odd.push_back(in[i]);
+    }
+    if (odd.empty()) return constant(parity, clauses);
+
+    // Chunks of up to xorCut inputs, each encoded directly: one clause per input
+    // assignment, forcing out to the parity of that assignment
+    while (odd.size() > 1) {
+        size_t n = std::min(odd.size(), xorCut);
+        int out = newVariable();
+        for (uint32_t bits = 0; bits < (1u << n); bits++) {
+            bool ones = false;
+            for (size_t j = 0; j < n; j++) {
+                bool set = (bits >> j) & 1;
+                ones ^= set;
+                clauses.addLiteral(set ? -odd[j] : odd[j]);
+            }
+            clauses.addLiteral(ones ? out : -out);
+            clauses.endClause();
+        }
+        odd.erase(odd.begin(), odd.begin() + n);
+        odd.push_back(out);
+    }
+    return parity ? -odd[0] : odd[0];
+}
+
+int CNFConverter::encodeMux(int a, int b, int sel, ClauseList& clauses) {
+    // out = sel ? b : a
+    bool value;
+    if (isConstant(sel, value)) return value ? b : a;
+    if (a == b) return a;
+    if (a == -b) return -encodeXor(Literals({sel, b}, scratch), clauses);
+    if (isConstant(a, value)) {
+        return value ? -encodeAnd(Literals({sel, -b}, scratch), clauses)
+                     : encodeAnd(Literals({sel, b}, scratch), clauses);
+    }
+    if (isConstant(b, value)) {
+        return value ? -encodeAnd(Literals({-sel, -a}, scratch), clauses)
+                     : encodeAnd(Literals({-sel, a}, scratch), clauses);
+    }
+
+    int out = newVariable();
+    // sel=0 -> out = a  => ( sel v -a v out) & ( sel v a v -out)
+    // sel=1 -> out = b  => (-sel v -b v out) & (-sel v b v -out)
+    clauses.add({sel, -a, out});
+    clauses.add({sel, a, -out});
+    clauses.add({-sel, -b, out});
+    clauses.add({-sel, b, -out});
+    return out;
+}
+
+int CNFConverter::encodeMaj(int a, int b, int c, ClauseList& clauses) {
+    bool value;
+    if (isConstant(a, value)) std::swap(a, c);
+    if (isConstant(b, value)) std::swap(b, c);
+    if (isConstant(c, value)) {
+        // MAJ(a, b, 0) = a & b, MAJ(a, b, 1) = a | b
+        return value ? -encodeAnd(Literals({-a, -b}, scratch), clauses) : encodeAnd(Literals({a, b}, scratch), clauses);
+    }
+    if (a == b || a == c) return a;
+    if (b == c) return b;
+    if (a == -b) return c;
+    if (a == -c) return b;
+    if (b == -c) return a;
+
+    // Any two inputs agreeing fix the output: 6 clauses, no helper variable
+    int out = newVariable();
+    clauses.add({-a, -b, out});
+    clauses.add({-a, -c, out});
+    clauses.add({-b, -c, out});
+    clauses.add({a, b, -out});
+    clauses.add({a, c, -out});
+    clauses.add({b, c, -out});
+    return out;
+}
+
+int CNFConverter::encodeEq(const Literals& pairs, ClauseList& clauses) {
+    // A pair with a constant side is a plain literal, equal pairs drop out, a complementary
+    // pair makes the whole comparison false
+    bool value;
+    Literals terms(scratch), a(scratch), b(scratch);
+    for (size_t i = 0; i + 1 < pairs.size(); i += 2) {
+        int x = pairs[i], y = pairs[i + 1];
+        if (isConstant(x, value)) std::swap(x, y);
+        if (isConstant(y, value)) {
+            terms.push_back(value ? x : -x);
+            continue;
+        }
+        if (x == y) continue;
+        if (x == -y) return constant(false, clauses);
+        a.push_back(x);
+        b.push_back(y);
+    }
+
+    // Chunks of up to xorCut pairs, each encoded directly: out forces every pair equal
+    // (two clauses per pair), and one clause per way of picking a "differs" clause
+    // (a v b or ~a v ~b) from every pair makes out true when all pairs agree
+    for (size_t start = 0; start < a.size(); start += xorCut) {
+        size_t n = std::min(a.size() - start, xorCut);
+        int out = newVariable();
+        for (size_t j = start; j < start + n; j++) {
+            clauses.add({-out, -a[j], b[j]});
+            clauses.add({-out, a[j], -b[j]});
+        }
+        for (uint32_t bits = 0; bits < (1u << n); bits++) {
+            for (size_t j = 0; j < n; j++) {
+                int sign = (bits >> j) & 1 ? -1 : 1;
+                clauses.addLiteral(sign * a[start + j]);
+                clauses.addLiteral(sign * b[start + j]);
+            }
+            clauses.addLiteral(out);
+            clauses.endClause();
+        }
+        terms.push_back(out);
+    }
+    return encodeAnd(terms, clauses);
+}
+
+int CNFConverter::gateToCNF(const Gate& gate, const Literals& in, ClauseList& clauses) {
+    // Inverting gates are their positive form with a complemented output literal, OR/NOR
+    // go through De Morgan, so every gate ends up as an AND, XOR, MUX, MAJ or EQ encoding
+    Literals negated(scratch);
+    for (int lit : in) negated.push_back(-lit);
+    switch (gate.type) {
+        case Gate::Type::BUF:  return in[0];
+        case Gate::Type::NOT:  return -in[0];
+        case Gate::Type::AND:  return encodeAnd(in, clauses);
+        case Gate::Type::NAND: return -encodeAnd(in, clauses);
+        case Gate::Type::OR:   return -encodeAnd(negated, clauses);
+        case Gate::Type::NOR:  return encodeAnd(negated, clauses);
+        case Gate::Type::XOR:  return encodeXor(in, clauses);
+        case Gate::Type::XNOR: return -encodeXor(in, clauses);
+        case Gate::Type::MUX:
+            if (in.size() != 3) throw std::runtime_error("MUX driving " + gate.output + " needs 3 inputs");
+            return encodeMux(in[0], in[1], in[2], clauses);
+        case Gate::Type::MAJ:
+            if (in.size() != 3) throw std::runtime_error("MAJ driving " + gate.output + " needs 3 inputs");
+            return encodeMaj(in[0], in[1], in[2], clauses);
+        case Gate::Type::EQ:
+            if (in.size() % 2 != 0) throw std::runtime_error("EQ driving " + gate.output + " needs input pairs");
+            return encodeEq(in, clauses);
     }
+    return in[0];
+}
+
+ClauseList CNFConverter::circuitToCNF(const LogicCircuit& circuit) {
+    std::vector<std::string> roots(circuit.wires.begin(), circuit.wires.end());
+    return encode(circuit, roots);
+}
+
+ClauseList CNFConverter::circuitToCNF(const LogicCircuit& circuit,
+                                                         const std::vector<std::string>& roots) {
+    for (const auto& root : roots) {
+        if (circuit.wires.find(root) == circuit.wires.end()) {
+            throw std::runtime_error("Unknown signal " + root);
+        }
+    }
+    return encode(circuit, roots);
+}
+
+ClauseList CNFConverter::encode(const LogicCircuit& circuit, const std::vector<std::string>& roots) {
+    resetVariables();
+    ClauseList clauses;
+    // Literal lists are scratch of this encoding, released in one go
+    PhaseArena arena(PhaseArena::CNF);
+    struct RestoreScratch {
+        std::pmr::memory_resource*& scratch;
+        ~RestoreScratch() { scratch = std::pmr::get_default_resource(); }
+    } restore{scratch};
+    scratch = arena.resource();
 
-    for (const auto& gate : circuit.gates) {
-        auto getClauses = gateToCNF(gate);
-        clauses.insert(clauses.end(), getClauses.begin(), getClauses.end());
+    // Every signal of the cones gets a literal, drivers first: a fresh variable for undriven
+    // signals and for the output of each encoded gate, and the folded literal of the
+    // source for BUFs, NOTs and gates that simplify away. Nothing outside the cones is
+    // numbered.
+    auto literal = [&](const std::string& name) {
+        auto v = variableMap.find(name);
+        if (v != variableMap.end()) return v->second;
+        bool constantNet = name == LogicCircuit::kConst0 || name == LogicCircuit::kConst1;
+        return variableMap[name] = constantNet ? constant(name == LogicCircuit::kConst1, clauses) : newVariable();
+    };
+    for (size_t g : circuit.cone(roots).gates) {
+        const Gate& gate = circuit.gates[g];
+        if (gate.inputs.empty()) {
+            throw std::runtime_error("Gate driving " + gate.output + " has no inputs");
+        }
+        Literals in(scratch);
+        for (const auto& input : gate.inputs) in.push_back(literal(input));
+        variableMap[gate.output] = gateToCNF(gate, in, clauses);
     }
+    for (const auto& root : roots) literal(root);
 
     return clauses;
 }
@@ -188,89 +686,698 @@ int CNFConverter::getNumVariables() const {
     return variableCounter;
 }
 
-// ---------------- VerilogParser ----------------
-std::string VerilogParser::generateTempName(const std::string& base, int& counter) {
-    return base + "_temp_" + std::to_string(counter++);
-}
+// ---------------- StructuralHasher ----------------
+namespace {
 
-std::vector<std::string> VerilogParser::tokenize(const std::string& expr) {
-    std::vector<std::string> tokens;
-    std::string current;
-    int parenCount = 0;
-    
-    for (size_t i = 0; i < expr.length(); i++) {
-        char c = expr[i];
-        if (isspace(static_cast<unsigned char>(c))) continue;
-        
-        if (c == '(') {
-            if (!current.empty()) {
-                tokens.push_back(current);
-                current = "";
-            }
-            parenCount++;
-            tokens.push_back("(");
-        }
-        else if (c == ')') {
-            if (!current.empty()) {
-                tokens.push_back(current);
-                current = "";
-            }
-            tokens.push_back(")");
-            parenCount--;
+// Literal 0 is constant false, literal 1 constant true.
+inline int litNode(int lit) { return lit >> 1; }
+inline bool litComp(int lit) { return (lit & 1) != 0; }
+
+struct StrashNode {
+    enum Kind { CONST, INPUT, AND, XOR, MUX, MAJ };
+    Kind kind;
+    int fanin[3];
+    std::string name;   // primary input name (INPUT only)
+};
+
+struct StrashKey {
+    int kind, a, b, c;
+    bool operator==(const StrashKey& o) const {
+        return kind == o.kind && a == o.a && b == o.b && c == o.c;
+    }
+};
+
+struct StrashKeyHash {
+    size_t operator()(const StrashKey& k) const {
+        size_t h = static_cast<size_t>(k.kind);
+        h = h * 0x9E3779B97F4A7C15ULL + static_cast<size_t>(k.a);
+        h = h * 0x9E3779B97F4A7C15ULL + static_cast<size_t>(k.b);
+        h = h * 0x9E3779B97F4A7C15ULL + static_cast<size_t>(k.c);
+        return h ^ (h >> 29);
+    }
+};
+
+class StrashGraph {
+public:
+    std::vector<StrashNode> nodes;
+
+    StrashGraph() {
+        StrashNode zero = {StrashNode::CONST, {0, 0, 0}, ""};
+        nodes.push_back(zero);
+    }
+
+    int input(const std::string& name) {
+        StrashNode n = {StrashNode::INPUT, {0, 0, 0}, name};
+        nodes.push_back(n);
+        return static_cast<int>(nodes.size() - 1) * 2;
+    }
+
+    int mkAnd(int a, int b) {
+        if (a > b) std::swap(a, b);
+        if (a == 0) return 0;
+        if (a == 1) return b;
+        if (a == b) return a;
+        if (a == (b ^ 1)) return 0;
+        return lookup(StrashNode::AND, a, b, 0);
+    }
+
+    int mkXor(int a, int b) {
+        int comp = (a & 1) ^ (b & 1);
+        a &= ~1;
+        b &= ~1;
+        if (a > b) std::swap(a, b);
+        if (a == b) return comp;
+        if (a == 0) return b ^ comp;
+        return lookup(StrashNode::XOR, a, b, 0) ^ comp;
+    }
+
+    // out = s ? b : a
+    int mkMux(int a, int b, int s) {
+        if (litComp(s)) {
+            std::swap(a, b);
+            s ^= 1;
         }
-        else if ((c == '&' || c == '|' || c == '^' || c == '~' || c == '!') && parenCount == 0) {
-            if (!current.empty()) {
-                tokens.push_back(current);
-                current = "";
-            }
-            // handle common multi-char operators
-            if (c == '&' && i + 1 < expr.length() && expr[i + 1] == '&') {
-                tokens.push_back("&&");
-                i++;
-            }
-            else if (c == '|' && i + 1 < expr.length() && expr[i + 1] == '|') {
-                tokens.push_back("||");
-                i++;
+        if (s == 0) return a;
+        if (a == b) return a;
+        if (a == (b ^ 1)) return mkXor(a, s);
+        if (a == 0) return mkAnd(s, b);
+        if (a == 1) return mkAnd(s, b ^ 1) ^ 1;
+        if (b == 0) return mkAnd(s ^ 1, a);
+        if (b == 1) return mkAnd(s ^ 1, a ^ 1) ^ 1;
+        if (litComp(a)) return lookup(StrashNode::MUX, a ^ 1, b ^ 1, s) ^ 1;
+        return lookup(StrashNode::MUX, a, b, s);
+    }
+
+    int mkMaj(int a, int b, int c) {
+        int f[3] = {a, b, c};
+        std::sort(f, f + 3);
+        // Constants and equal or opposite fanins reduce to AND/OR or a plain fanin
+        if (f[0] == 0) return mkAnd(f[1], f[2]);
+        if (f[0] == 1) return mkAnd(f[1] ^ 1, f[2] ^ 1) ^ 1;
+        if (f[0] == f[1] || f[1] == f[2]) return f[1];
+        if (f[0] == (f[1] ^ 1)) return f[2];
+        if (f[1] == (f[2] ^ 1)) return f[0];
+        if (f[0] == (f[2] ^ 1)) return f[1];
+        // Self-dual: keep at most one complemented fanin in the table
+        int comps = litComp(f[0]) + litComp(f[1]) + litComp(f[2]);
+        if (comps >= 2) return mkMaj(f[0] ^ 1, f[1] ^ 1, f[2] ^ 1) ^ 1;
+        return lookup(StrashNode::MAJ, f[0], f[1], f[2]);
+    }
+
+private:
+    std::unordered_map<StrashKey, int, StrashKeyHash> table;
+
+    int lookup(StrashNode::Kind kind, int a, int b, int c) {
+        StrashKey key = {static_cast<int>(kind), a, b, c};
+        auto it = table.find(key);
+        if (it != table.end()) return it->second;
+        StrashNode n = {kind, {a, b, c}, ""};
+        nodes.push_back(n);
+        int lit = static_cast<int>(nodes.size() - 1) * 2;
+        table.emplace(key, lit);
+        return lit;
+    }
+};
+
+int strashGate(StrashGraph& graph, const Gate& gate, const std::vector<int>& in) {
+    if (in.empty()) {
+        throw std::runtime_error("Gate driving " + gate.output + " has no inputs");
+    }
+    int acc = in[0];
+    switch (gate.type) {
+        case Gate::Type::BUF:
+            return in[0];
+        case Gate::Type::NOT:
+            return in[0] ^ 1;
+        case Gate::Type::AND:
+        case Gate::Type::NAND:
+            for (size_t i = 1; i < in.size(); i++) acc = graph.mkAnd(acc, in[i]);
+            return gate.type == Gate::Type::NAND ? acc ^ 1 : acc;
+        case Gate::Type::OR:
+        case Gate::Type::NOR:
+            // De Morgan: OR(a, b) = ~AND(~a, ~b), so ORs and ANDs share one table
+            acc ^= 1;
+            for (size_t i = 1; i < in.size(); i++) acc = graph.mkAnd(acc, in[i] ^ 1);
+            return gate.type == Gate::Type::OR ? acc ^ 1 : acc;
+        case Gate::Type::XOR:
+        case Gate::Type::XNOR:
+            for (size_t i = 1; i < in.size(); i++) acc = graph.mkXor(acc, in[i]);
+            return gate.type == Gate::Type::XNOR ? acc ^ 1 : acc;
+        case Gate::Type::MUX:
+            if (in.size() != 3) {
+                throw std::runtime_error("MUX driving " + gate.output + " needs 3 inputs");
             }
-            else if (c == '^' && i + 1 < expr.length() && expr[i + 1] == '~') {
-                tokens.push_back("^~");
-                i++;
+            return graph.mkMux(in[0], in[1], in[2]);
+        case Gate::Type::MAJ:
+            if (in.size() != 3) {
+                throw std::runtime_error("MAJ driving " + gate.output + " needs 3 inputs");
             }
-            else if (c == '~' && i + 1 < expr.length() && expr[i + 1] == '^') {
-                tokens.push_back("~^");
-                i++;
+            return graph.mkMaj(in[0], in[1], in[2]);
+        case Gate::Type::EQ:
+            if (in.size() % 2 != 0) {
+                throw std::runtime_error("EQ driving " + gate.output + " needs input pairs");
             }
-            else {
-                tokens.push_back(std::string(1, c));
+            // AND of the pairwise XNORs
+            acc = graph.mkXor(in[0], in[1]) ^ 1;
+            for (size_t i = 2; i + 1 < in.size(); i += 2) acc = graph.mkAnd(acc, graph.mkXor(in[i], in[i + 1]) ^ 1);
+            return acc;
+    }
+    return acc;
+}
+
+} // namespace
+
+LogicCircuit StructuralHasher::hash(const LogicCircuit& circuit, const std::vector<std::string>& roots,
+                                    std::unordered_map<std::string, bool>& constants) {
+    // ---- Build the hashed graph bottom-up, drivers first ----
+    StrashGraph graph;
+    std::unordered_map<std::string, int> literalOf;
+    std::vector<int> in;
+    auto literal = [&](const std::string& name) {
+        auto l = literalOf.find(name);
+        if (l != literalOf.end()) return l->second;
+        bool value;
+        return literalOf[name] = isConstantNet(name, value) ? value : graph.input(name);
+    };
+    for (size_t g : circuit.cone(roots).gates) {
+        const Gate& gate = circuit.gates[g];
+        in.clear();
+        for (const auto& input : gate.inputs) in.push_back(literal(input));
+        literalOf[gate.output] = strashGate(graph, gate, in);
+    }
+    for (const auto& root : roots) literal(root);
+
+    // ---- Decide which polarities of each node are referenced (reverse topological) ----
+    const std::vector<StrashNode>& nodes = graph.nodes;
+    std::vector<unsigned char> need(nodes.size(), 0);   // bit 0: positive, bit 1: complemented
+    for (const auto& entry : literalOf) {
+        if (litNode(entry.second) == 0) constants[entry.first] = litComp(entry.second);
+    }
+    for (const auto& root : roots) {
+        int lit = literalOf[root];
+        if (litNode(lit) != 0) need[litNode(lit)] |= litComp(lit) ? 2 : 1;
+    }
+    for (size_t n = nodes.size(); n-- > 1;) {
+        if (!need[n]) continue;
+        const StrashNode& node = nodes[n];
+        if (node.kind == StrashNode::AND) {
+            int a = node.fanin[0], b = node.fanin[1];
+            if (litComp(a) && litComp(b)) {
+                // realized as NOR/OR over the positive fanins
+                need[litNode(a)] |= 1;
+                need[litNode(b)] |= 1;
+            } else {
+                need[litNode(a)] |= litComp(a) ? 2 : 1;
+                need[litNode(b)] |= litComp(b) ? 2 : 1;
             }
+        } else if (node.kind == StrashNode::XOR) {
+            need[litNode(node.fanin[0])] |= 1;
+            need[litNode(node.fanin[1])] |= 1;
+        } else if (node.kind == StrashNode::MUX || node.kind == StrashNode::MAJ) {
+            need[n] |= 1;
+            for (int f : node.fanin) need[litNode(f)] |= litComp(f) ? 2 : 1;
         }
-        else if (c == '~' || c == '!') {
-            if (!current.empty()) {
-                tokens.push_back(current);
-                current = "";
+    }
+
+    // ---- Name the nodes, preferring root names so outputs need no buffers ----
+    std::vector<std::string> posName(nodes.size()), negName(nodes.size());
+    std::vector<std::pair<std::string, std::string>> rootBuffers;
+    for (size_t n = 1; n < nodes.size(); n++) {
+        if (nodes[n].kind == StrashNode::INPUT) posName[n] = nodes[n].name;
+    }
+    for (const auto& root : roots) {
+        int lit = literalOf[root];
+        if (litNode(lit) == 0) continue;
+        std::string& slot = litComp(lit) ? negName[litNode(lit)] : posName[litNode(lit)];
+        if (slot.empty()) {
+            slot = root;
+        } else if (slot != root) {
+            rootBuffers.push_back({root, slot});
+        }
+    }
+    auto nameOf = [&](int lit) -> const std::string& {
+        int n = litNode(lit);
+        std::string& slot = litComp(lit) ? negName[n] : posName[n];
+        if (slot.empty()) slot = "strash_" + std::to_string(n) + (litComp(lit) ? "_n" : "");
+        return slot;
+    };
+
+    // ---- Emit gates in node order, which is topological ----
+    LogicCircuit result;
+    result.name = circuit.name;
+    for (size_t n = 1; n < nodes.size(); n++) {
+        if (!need[n]) continue;
+        const StrashNode& node = nodes[n];
+        int pos = static_cast<int>(n) * 2;
+        bool wantPos = (need[n] & 1) != 0;
+        bool wantNeg = (need[n] & 2) != 0;
+
+        if (node.kind == StrashNode::INPUT) {
+            result.inputs.insert(node.name);
+            result.wires.insert(node.name);
+            if (wantNeg) result.addGate(Gate(Gate::Type::NOT, {node.name}, nameOf(pos ^ 1)));
+            continue;
+        }
+
+        Gate::Type posType = Gate::Type::AND, negType = Gate::Type::NAND;
+        std::vector<std::string> fanins;
+        if (node.kind == StrashNode::AND) {
+            int a = node.fanin[0], b = node.fanin[1];
+            if (litComp(a) && litComp(b)) {
+                posType = Gate::Type::NOR;
+                negType = Gate::Type::OR;
+                fanins = {nameOf(a ^ 1), nameOf(b ^ 1)};
+            } else {
+                fanins = {nameOf(a), nameOf(b)};
             }
-            tokens.push_back(std::string(1, c));
+        } else if (node.kind == StrashNode::XOR) {
+            posType = Gate::Type::XOR;
+            negType = Gate::Type::XNOR;
+            fanins = {nameOf(node.fanin[0]), nameOf(node.fanin[1])};
+        } else {
+            posType = node.kind == StrashNode::MUX ? Gate::Type::MUX : Gate::Type::MAJ;
+            fanins = {nameOf(node.fanin[0]), nameOf(node.fanin[1]), nameOf(node.fanin[2])};
         }
-        else {
-            current += c;
+
+        if (wantPos) {
+            result.addGate(Gate(posType, fanins, nameOf(pos)));
+            if (wantNeg) result.addGate(Gate(Gate::Type::NOT, {nameOf(pos)}, nameOf(pos ^ 1)));
+        } else {
+            result.addGate(Gate(negType, fanins, nameOf(pos ^ 1)));
         }
     }
-    
-    if (!current.empty()) {
-        tokens.push_back(current);
+    for (const auto& buf : rootBuffers) {
+        result.addGate(Gate(Gate::Type::BUF, {buf.second}, buf.first));
     }
-    
+    for (const auto& root : roots) {
+        if (litNode(literalOf[root]) != 0) result.outputs.insert(root);
+    }
+
+    return result;
+}
+
+// ---------------- GateFusion ----------------
+LogicCircuit GateFusion::fuse(const LogicCircuit& circuit, size_t xorCut, const std::vector<std::string>& keep) {
+    // Consumers are visited before producers (reverse topological order), so each
+    // absorbable gate is decided before it is visited itself
+    const Levelization& levels = circuit.levelize();
+    if (!levels.cycle.empty()) {
+        throw std::runtime_error("Combinational loop through " + levels.cycle[0]);
+    }
+    std::unordered_set<std::string> kept(keep.begin(), keep.end());
+    kept.insert(circuit.outputs.begin(), circuit.outputs.end());
+
+    auto base = [](Gate::Type type) {
+        switch (type) {
+            case Gate::Type::NAND: return Gate::Type::AND;
+            case Gate::Type::NOR:  return Gate::Type::OR;
+            case Gate::Type::XNOR: return Gate::Type::XOR;
+            default: return type;
+        }
+    };
+    // Gate that may disappear into its single consumer
+    auto absorbable = [&](const std::string& signal, Gate::Type into) -> const Gate* {
+        size_t d = circuit.driverOf(signal);
+        if (d == circuit.gates.size() || levels.fanout[d] != 1 || kept.count(signal)) return nullptr;
+        const Gate& gate = circuit.gates[d];
+        return gate.type == into ? &gate : nullptr;
+    };
+
+    PhaseArena arena(PhaseArena::CIRCUIT);
+    std::pmr::vector<char> absorbed(circuit.gates.size(), 0, arena.resource());
+    std::vector<std::vector<std::string>> fusedInputs(circuit.gates.size());
+    for (auto it = levels.order.rbegin(); it != levels.order.rend(); ++it) {
+        size_t g = *it;
+        if (absorbed[g]) continue;
+        const Gate& gate = circuit.gates[g];
+        Gate::Type into = base(gate.type);
+        std::vector<std::string> leaves = gate.inputs;
+        if (into == Gate::Type::AND || into == Gate::Type::OR || into == Gate::Type::XOR) {
+            for (size_t i = 0; i < leaves.size();) {
+                const Gate* child = absorbable(leaves[i], into);
+                if (!child || (into == Gate::Type::XOR && leaves.size() - 1 + child->inputs.size() > xorCut)) {
+                    i++;
+                    continue;
+                }
+                absorbed[circuit.driverOf(leaves[i])] = 1;
+                std::vector<std::string> childInputs = child->inputs;
+                leaves.erase(leaves.begin() + i);
+                leaves.insert(leaves.end(), childInputs.begin(), childInputs.end());
+            }
+        }
+        fusedInputs[g] = leaves;
+    }
+
+    LogicCircuit fused;
+    fused.name = circuit.name;
+    fused.inputs = circuit.inputs;
+    fused.outputs = circuit.outputs;
+    fused.registers = circuit.registers;
+    fused.latches = circuit.latches;
+    for (const auto& wire : circuit.wires) {
+        size_t d = circuit.driverOf(wire);
+        if (d == circuit.gates.size() || !absorbed[d]) fused.wires.insert(wire);
+    }
+    for (size_t g = 0; g < circuit.gates.size(); g++) {
+        if (absorbed[g]) continue;
+        fused.addGate(Gate(circuit.gates[g].type, fusedInputs[g], circuit.gates[g].output));
+    }
+    return fused;
+}
+
+// ---------------- VerilogParser ----------------
+bool VerilogParser::verbose = false;
+AdderArchitecture VerilogParser::adderArchitecture = AdderArchitecture::RIPPLE;
+MultiplierArchitecture VerilogParser::multiplierArchitecture = MultiplierArchitecture::DADDA;
+bool VerilogParser::canonicalPartialProducts = false;
+bool VerilogParser::directComparators = false;
+
+bool VerilogParser::isVectorArithmetic(const std::string& expr) {
+    return expr.find_first_of("+-*") != std::string::npos || expr.find("<<") != std::string::npos ||
+           expr.find(">>") != std::string::npos;
+}
+
+bool VerilogParser::literalValue(const std::string& text, std::vector<bool>& value) {
+    size_t tick = text.find('\'');
+    int base = 10;
+    std::string digits = text;
+    if (tick != std::string::npos) {
+        for (size_t i = 0; i < tick; i++) {
+            if (!isdigit(static_cast<unsigned char>(text[i]))) return false;
+        }
+        size_t pos = tick + 1;
+        if (pos < text.size() && (text[pos] == 's' || text[pos] == 'S')) pos++;
+        if (pos >= text.size()) return false;
+        switch (tolower(static_cast<unsigned char>(text[pos]))) {
+            case 'b': base = 2; break;
+            case 'o': base = 8; break;
+            case 'd': base = 10; break;
+            case 'h': base = 16; break;
+            default: return false;
+        }
+        digits = text.substr(pos + 1);
+    }
+    digits.erase(std::remove(digits.begin(), digits.end(), '_'), digits.end());
+    if (digits.empty()) return false;
+    // value = value * base + d over 32-bit limbs, LSB first, so no digit count overflows
+    std::vector<uint32_t> limbs;
+    for (char c : digits) {
+        int d = isdigit(static_cast<unsigned char>(c)) ? c - '0'
+              : isxdigit(static_cast<unsigned char>(c)) ? tolower(static_cast<unsigned char>(c)) - 'a' + 10 : base;
+        if (d >= base) return false;
+        uint64_t carry = d;
+        for (uint32_t& limb : limbs) {
+            uint64_t t = uint64_t(limb) * base + carry;
+            limb = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        if (carry) limbs.push_back(static_cast<uint32_t>(carry));
+    }
+    value.clear();
+    for (uint32_t limb : limbs) {
+        for (int i = 0; i < 32; i++) value.push_back(limb >> i & 1);
+    }
+    while (!value.empty() && !value.back()) value.pop_back();
+    return true;
+}
+
+bool VerilogParser::parseIntegerLiteral(const std::string& text, uint64_t& value) {
+    std::vector<bool> bits;
+    if (!literalValue(text, bits)) return false;
+    if (bits.size() > 64) throw std::runtime_error("Literal does not fit in 64 bits: " + text);
+    value = 0;
+    for (size_t i = 0; i < bits.size(); i++) value |= uint64_t(bits[i]) << i;
+    return true;
+}
+
+bool VerilogParser::literalBits(const std::string& text, std::vector<std::string>& bits) {
+    std::vector<bool> value;
+    size_t tick = text.find('\'');
+    if (tick == std::string::npos || tick == 0 || !literalValue(text, value)) return false;
+    int width = std::stoi(text.substr(0, tick));
+    if (width <= 0) return false;
+    bits.clear();
+    for (int i = width - 1; i >= 0; i--) bits.push_back(constantNet(static_cast<size_t>(i) < value.size() && value[i]));
+    return true;
+}
+
+std::string VerilogParser::trim(const std::string& s) {
+    auto start = std::find_if(s.begin(), s.end(), [](unsigned char c) { return !isspace(c); });
+    auto end = std::find_if(s.rbegin(), s.rend(), [](unsigned char c) { return !isspace(c); }).base();
+    return (start < end) ? std::string(start, end) : "";
+}
+
+namespace {
+
+// Scratch memory of the parse running on this thread (its PARSE arena), heap otherwise
+thread_local std::pmr::memory_resource* parseResource = std::pmr::get_default_resource();
+// Word-level graph of the parse running on this thread
+thread_local WordGraph* wordGraph = nullptr;
+
+// Tokens of a word expression: identifiers, literals (8'hff, 'b1, 12) and operators,
+// longest operator first, in the parse arena
+std::pmr::vector<std::string> wordTokens(const std::string& expr) {
+    static const char* const operators[] = {">>>", "<<", ">>", "<=", ">=", "==", "!=", "~^", "^~", "~&", "~|",
+                                            "&&", "||"};
+    std::pmr::vector<std::string> tokens(parseResource);
+    for (size_t i = 0; i < expr.size();) {
+        char c = expr[i];
+        if (isspace(static_cast<unsigned char>(c))) {
+            i++;
+        } else if (isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$' || c == '\'') {
+            size_t end = i + 1;
+            while (end < expr.size() && (isalnum(static_cast<unsigned char>(expr[end])) || expr[end] == '_' ||
+                                         expr[end] == '$' || expr[end] == '\'')) end++;
+            tokens.push_back(expr.substr(i, end - i));
+            i = end;
+        } else {
+            std::string token(1, c);
+            for (const char* op : operators) {
+                if (expr.compare(i, std::strlen(op), op) == 0) {
+                    token = op;
+                    break;
+                }
+            }
+            tokens.push_back(token);
+            i += token.size();
+        }
+    }
+    return tokens;
+}
+
+bool isReduction(const std::string& token) {
+    return token == "&" || token == "|" || token == "^" || token == "~&" || token == "~|" || token == "~^" ||
+           token == "^~";
+}
+
+bool isIdentifier(const std::string& token) {
+    return !token.empty() && (isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_' || token[0] == '$') &&
+           token.find('\'') == std::string::npos;
+}
+
+} // namespace
+
+VerilogParser::TokenList VerilogParser::tokenize(const std::string& expr) {
+    TokenList tokens(parseResource);
+    Token current(parseResource);
+    int parenCount = 0;
+    
+    for (size_t i = 0; i < expr.length(); i++) {
+        char c = expr[i];
+        if (isspace(static_cast<unsigned char>(c))) continue;
+        
+        if (c == '(') {
+            if (!current.empty()) {
+                tokens.push_back(current);
+                current = "";
+            }
+            parenCount++;
+            tokens.push_back("(");
+        }
+        else if (c == ')') {
+            if (!current.empty()) {
+                tokens.push_back(current);
+                current = "";
+            }
+            tokens.push_back(")");
+            parenCount--;
+        }
+        else if ((c == '&' || c == '|' || c == '^' || c == '~' || c == '!') && parenCount == 0) {
+            if (!current.empty()) {
+                tokens.push_back(current);
+                current = "";
+            }
+            // handle common multi-char operators
+            if (c == '&' && i + 1 < expr.length() && expr[i + 1] == '&') {
+                tokens.push_back("&&");
+                i++;
+            }
+            else if (c == '|' && i + 1 < expr.length() && expr[i + 1] == '|') {
+                tokens.push_back("||");
+                i++;
+            }
+            else if (c == '^' && i + 1 < expr.length() && expr[i + 1] == '~') {
+                tokens.push_back("^~");
+                i++;
+            }
+            else if (c == '~' && i + 1 < expr.length() && expr[i + 1] == '^') {
+                tokens.push_back("~^");
+                i++;
+            }
+            else {
+                tokens.emplace_back(1, c);
+            }
+        }
+        else if (c == '~' || c == '!') {
+            if (!current.empty()) {
+                tokens.push_back(current);
+                current = "";
+            }
+            tokens.emplace_back(1, c);
+        }
+        else {
+            current += c;
+        }
+    }
+    
+    if (!current.empty()) {
+        tokens.push_back(current);
+    }
+    
     return tokens;
 }
 
 std::string VerilogParser::parseExpression(const std::string& expr, const std::string& target, 
-                                         LogicCircuit& circuit, int& tempCounter) {
+                                         LogicCircuit& circuit) {
     std::string cleaned = expr;
     cleaned.erase(std::remove_if(cleaned.begin(), cleaned.end(), ::isspace), cleaned.end());
     
     if (cleaned.empty()) return "";
+
+    // Module-wide CSE: an expression already built anywhere in the module is reused.
+    // Arithmetic is left out, it may drive a whole vector rather than the net `target`.
+    bool shareable = !isVectorArithmetic(cleaned);
+    if (shareable) {
+        auto seen = circuit.expressions.find(cleaned);
+        if (seen != circuit.expressions.end()) return seen->second;
+    }
+    std::string result = buildExpression(cleaned, target, circuit);
+    if (shareable && result == target) circuit.expressions.emplace(cleaned, target);
+    return result;
+}
+
+std::string VerilogParser::buildExpression(const std::string& cleaned, const std::string& target,
+                                         LogicCircuit& circuit) {
+    
+    // Vector addition: a + b
+    size_t plusPos = cleaned.find('+');
+    if (plusPos != std::string::npos && plusPos > 0 && plusPos < cleaned.length() - 1) {
+        int parenCount = 0;
+        bool topLevel = true;
+        for (size_t i = 0; i < plusPos; i++) {
+            if (cleaned[i] == '(') parenCount++;
+            else if (cleaned[i] == ')') parenCount--;
+        }
+        if (parenCount != 0) topLevel = false;
+        
+        if (topLevel) {
+            std::string leftOp = cleaned.substr(0, plusPos);
+            std::string rightOp = cleaned.substr(plusPos + 1);
+            
+            std::string leftBase = extractBaseName(leftOp);
+            std::string rightBase = extractBaseName(rightOp);
+            std::string targetBase = extractBaseName(target);
+            
+            if (isVectorBase(leftBase, circuit) && isVectorBase(rightBase, circuit)) {
+                generateAdder(leftBase, rightBase, targetBase, circuit);
+                return target;
+            } else {
+                return generateAdder(leftOp, rightOp, target, circuit);
+            }
+        }
+    }
     
-    // Handle ternary MUX: sel ? b : a
+    // Vector subtraction: a - b
+    size_t minusPos = cleaned.find('-');
+    if (minusPos != std::string::npos && minusPos > 0 && minusPos < cleaned.length() - 1) {
+        int parenCount = 0;
+        bool topLevel = true;
+        for (size_t i = 0; i < minusPos; i++) {
+            if (cleaned[i] == '(') parenCount++;
+            else if (cleaned[i] == ')') parenCount--;
+        }
+        if (parenCount != 0) topLevel = false;
+        
+        if (topLevel) {
+            std::string leftOp = cleaned.substr(0, minusPos);
+            std::string rightOp = cleaned.substr(minusPos + 1);
+            
+            std::string leftBase = extractBaseName(leftOp);
+            std::string rightBase = extractBaseName(rightOp);
+            std::string targetBase = extractBaseName(target);
+            
+            if (isVectorBase(leftBase, circuit) && isVectorBase(rightBase, circuit)) {
+                generateSubtractor(leftBase, rightBase, targetBase, circuit);
+                return target;
+            } else {
+                return generateSubtractor(leftOp, rightOp, target, circuit);
+            }
+        }
+    }
+
+    // Vector multiplication: a * b
+    size_t timesPos = cleaned.find('*');
+    if (timesPos != std::string::npos && timesPos > 0 && timesPos < cleaned.length() - 1) {
+        int parenCount = 0;
+        for (size_t i = 0; i < timesPos; i++) {
+            if (cleaned[i] == '(') parenCount++;
+            else if (cleaned[i] == ')') parenCount--;
+        }
+
+        if (parenCount == 0) {
+            std::string leftOp = cleaned.substr(0, timesPos);
+            std::string rightOp = cleaned.substr(timesPos + 1);
+
+            std::string leftBase = extractBaseName(leftOp);
+            std::string rightBase = extractBaseName(rightOp);
+            std::string targetBase = extractBaseName(target);
+
+            if (isVectorBase(leftBase, circuit) && isVectorBase(rightBase, circuit)) {
+                generateMultiplier(leftBase, rightBase, targetBase, circuit);
+                return target;
+            } else {
+                return generateMultiplier(leftOp, rightOp, target, circuit);
+            }
+        }
+    }
+
+    // Vector shifts: a << n, a >> n, a >>> n with a constant or signal amount
+    size_t shiftPos = std::string::npos;
+    int depth = 0;
+    for (size_t i = 0; i + 2 < cleaned.size(); i++) {
+        if (cleaned[i] == '(') depth++;
+        else if (cleaned[i] == ')') depth--;
+        else if (depth == 0 && i > 0 && (cleaned[i] == '<' || cleaned[i] == '>') && cleaned[i + 1] == cleaned[i]) {
+            shiftPos = i;
+            break;
+        }
+    }
+    if (shiftPos != std::string::npos) {
+        size_t opLen = cleaned[shiftPos + 2] == cleaned[shiftPos] ? 3 : 2;
+        std::string leftOp = cleaned.substr(0, shiftPos);
+        std::string rightOp = cleaned.substr(shiftPos + opLen);
+        std::string targetBase = extractBaseName(target);
+        std::string leftBase = extractBaseName(leftOp);
+        std::string rightBase = extractBaseName(rightOp);
+        // A whole amount vector shows up as one of its bits in a per-bit instance
+        if (isVectorBase(rightBase, circuit)) rightOp = rightBase;
+        if (isVectorBase(leftBase, circuit)) {
+            generateShifter(cleaned.substr(shiftPos, opLen), leftBase, rightOp, targetBase, circuit);
+            return target;
+        }
+        return generateShifter(cleaned.substr(shiftPos, opLen), leftOp, rightOp, target, circuit);
+    }
+        // Handle ternary MUX: sel ? b : a
     size_t quesPos = cleaned.find('?');
     size_t colonPos = cleaned.find(':', quesPos);
     if (quesPos != std::string::npos && colonPos != std::string::npos) {
@@ -293,18 +1400,24 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
             std::string sel = cleaned.substr(0, quesPos);
             std::string b = cleaned.substr(quesPos + 1, colonPos - quesPos - 1);
             std::string a = cleaned.substr(colonPos + 1);
-            std::string selParsed = parseExpression(sel, target + "_sel", circuit, tempCounter);
-            std::string aParsed = parseExpression(a, target + "_a", circuit, tempCounter);
-            std::string bParsed = parseExpression(b, target + "_b", circuit, tempCounter);
+            std::string selParsed = parseExpression(sel, circuit.newTemp(), circuit);
+            std::string aParsed = parseExpression(a, circuit.newTemp(), circuit);
+            std::string bParsed = parseExpression(b, circuit.newTemp(), circuit);
             circuit.addGate(Gate(Gate::Type::MUX, {aParsed, bParsed, selParsed}, target));
             return target;
         }
     }
     
-    // Special-case: patterns like ~(a | b)  => create NOR
-    if (cleaned.size() >= 4 && cleaned[0] == '~' && cleaned[1] == '(' && cleaned.back() == ')') {
+    // Special-case: patterns like ~(a | b)  => create NOR. The parenthesis after '~' must
+    // close at the very end, ~(a ^ b) & ~(c ^ d) is an AND.
+    bool wrapped = cleaned.size() >= 4 && cleaned[0] == '~' && cleaned[1] == '(' && cleaned.back() == ')';
+    for (size_t i = 1, depth = 0; wrapped && i + 1 < cleaned.size(); i++) {
+        if (cleaned[i] == '(') depth++;
+        else if (cleaned[i] == ')' && --depth == 0) wrapped = false;
+    }
+    if (wrapped) {
         std::string inner = cleaned.substr(2, cleaned.size() - 3);
-        std::vector<std::string> innerTokens = tokenize(inner);
+        TokenList innerTokens = tokenize(inner);
         for (size_t i = 0; i < innerTokens.size(); i++) {
             if (innerTokens[i] == "^") {
                 size_t opPos = inner.find('^');
@@ -314,8 +1427,8 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
                     left.erase(std::remove_if(left.begin(), left.end(), ::isspace), left.end());
                     right.erase(std::remove_if(right.begin(), right.end(), ::isspace), right.end());
                     if (!left.empty() && !right.empty()) {
-                        std::string leftParsed = parseExpression(left, target + "_left", circuit, tempCounter);
-                        std::string rightParsed = parseExpression(right, target + "_right", circuit, tempCounter);
+                        std::string leftParsed = parseExpression(left, circuit.newTemp(), circuit);
+                        std::string rightParsed = parseExpression(right, circuit.newTemp(), circuit);
                         circuit.addGate(Gate(Gate::Type::XNOR, {leftParsed, rightParsed}, target));
                         return target;
                     }
@@ -329,8 +1442,8 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
                     left.erase(std::remove_if(left.begin(), left.end(), ::isspace), left.end());
                     right.erase(std::remove_if(right.begin(), right.end(), ::isspace), right.end());
                     if (!left.empty() && !right.empty()) {
-                        std::string leftParsed = parseExpression(left, target + "_left", circuit, tempCounter);
-                        std::string rightParsed = parseExpression(right, target + "_right", circuit, tempCounter);
+                        std::string leftParsed = parseExpression(left, circuit.newTemp(), circuit);
+                        std::string rightParsed = parseExpression(right, circuit.newTemp(), circuit);
                         // ~(left | right) == NOR(left, right)
                         circuit.addGate(Gate(Gate::Type::NOR, {leftParsed, rightParsed}, target));
                         return target;
@@ -345,8 +1458,8 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
                     left.erase(std::remove_if(left.begin(), left.end(), ::isspace), left.end());
                     right.erase(std::remove_if(right.begin(), right.end(), ::isspace), right.end());
                     if (!left.empty() && !right.empty()) {
-                        std::string leftParsed = parseExpression(left, target + "_left", circuit, tempCounter);
-                        std::string rightParsed = parseExpression(right, target + "_right", circuit, tempCounter);
+                        std::string leftParsed = parseExpression(left, circuit.newTemp(), circuit);
+                        std::string rightParsed = parseExpression(right, circuit.newTemp(), circuit);
                         // ~(left & right) == NAND(left, right)
                         circuit.addGate(Gate(Gate::Type::NAND, {leftParsed, rightParsed}, target));
                         return target;
@@ -356,14 +1469,6 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
         }
     }
     
-    // Unary NOT
-    if (cleaned[0] == '~' || cleaned[0] == '!') {
-        std::string operand = cleaned.substr(1);
-        std::string operandParsed = parseExpression(operand, target + "_not", circuit, tempCounter);
-        circuit.addGate(Gate(Gate::Type::NOT, {operandParsed}, target));
-        return target;
-    }
-    
     // Parentheses only
     if (cleaned.front() == '(' && cleaned.back() == ')') {
         int parenCount = 0;
@@ -377,17 +1482,17 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
             }
         }
         if (balanced) {
-            return parseExpression(cleaned.substr(1, cleaned.size() - 2), target, circuit, tempCounter);
+            return parseExpression(cleaned.substr(1, cleaned.size() - 2), target, circuit);
         }
     }
     
     // Tokenize and handle XOR with no parentheses precedence issues
-    std::vector<std::string> tokens = tokenize(cleaned);
+    TokenList tokens = tokenize(cleaned);
     
     std::vector<std::string> xorParts;
     std::string currentPart;
     int parenCount = 0;
-    for (const std::string& token : tokens) {
+    for (const Token& token : tokens) {
         if (token == "(") parenCount++;
         else if (token == ")") parenCount--;
         else if (token == "^" && parenCount == 0) {
@@ -398,15 +1503,17 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
             continue;
         }
         if (!currentPart.empty()) currentPart += " ";
-        currentPart += token;
+        currentPart += std::string_view(token);
     }
     if (!currentPart.empty()) xorParts.push_back(currentPart);
+    // Operand order is irrelevant, sorting lets reordered chains share gates
+    std::sort(xorParts.begin(), xorParts.end());
     
     if (xorParts.size() > 1) {
-        std::string current = parseExpression(xorParts[0], target + "_xor0", circuit, tempCounter);
+        std::string current = parseExpression(xorParts[0], circuit.newTemp(), circuit);
         for (size_t i = 1; i < xorParts.size(); i++) {
-            std::string nextPart = parseExpression(xorParts[i], target + "_xor" + std::to_string(i), circuit, tempCounter);
-            std::string tempName = (i == xorParts.size() - 1) ? target : generateTempName(target + "_xor", tempCounter);
+            std::string nextPart = parseExpression(xorParts[i], circuit.newTemp(), circuit);
+            std::string tempName = (i == xorParts.size() - 1) ? target : circuit.newTemp();
             circuit.addGate(Gate(Gate::Type::XOR, {current, nextPart}, tempName));
             current = tempName;
         }
@@ -417,7 +1524,7 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
     std::vector<std::string> orParts;
     currentPart = "";
     parenCount = 0;
-    for (const std::string& token : tokens) {
+    for (const Token& token : tokens) {
         if (token == "(") parenCount++;
         else if (token == ")") parenCount--;
         else if ((token == "|" || token == "||") && parenCount == 0) {
@@ -428,15 +1535,17 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
             continue;
         }
         if (!currentPart.empty()) currentPart += " ";
-        currentPart += token;
+        currentPart += std::string_view(token);
     }
     if (!currentPart.empty()) orParts.push_back(currentPart);
+    // Operand order is irrelevant, sorting lets reordered chains share gates
+    std::sort(orParts.begin(), orParts.end());
     
     if (orParts.size() > 1) {
-        std::string current = parseExpression(orParts[0], target + "_or0", circuit, tempCounter);
+        std::string current = parseExpression(orParts[0], circuit.newTemp(), circuit);
         for (size_t i = 1; i < orParts.size(); i++) {
-            std::string nextPart = parseExpression(orParts[i], target + "_or" + std::to_string(i), circuit, tempCounter);
-            std::string tempName = (i == orParts.size() - 1) ? target : generateTempName(target + "_or", tempCounter);
+            std::string nextPart = parseExpression(orParts[i], circuit.newTemp(), circuit);
+            std::string tempName = (i == orParts.size() - 1) ? target : circuit.newTemp();
             circuit.addGate(Gate(Gate::Type::OR, {current, nextPart}, tempName));
             current = tempName;
         }
@@ -447,7 +1556,7 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
     std::vector<std::string> andParts;
     currentPart = "";
     parenCount = 0;
-    for (const std::string& token : tokens) {
+    for (const Token& token : tokens) {
         if (token == "(") parenCount++;
         else if (token == ")") parenCount--;
         else if ((token == "&" || token == "&&") && parenCount == 0) {
@@ -458,274 +1567,1706 @@ std::string VerilogParser::parseExpression(const std::string& expr, const std::s
             continue;
         }
         if (!currentPart.empty()) currentPart += " ";
-        currentPart += token;
+        currentPart += std::string_view(token);
     }
     if (!currentPart.empty()) andParts.push_back(currentPart);
+    // Operand order is irrelevant, sorting lets reordered chains share gates
+    std::sort(andParts.begin(), andParts.end());
     
     if (andParts.size() > 1) {
-        std::string current = parseExpression(andParts[0], target + "_and0", circuit, tempCounter);
+        std::string current = parseExpression(andParts[0], circuit.newTemp(), circuit);
         for (size_t i = 1; i < andParts.size(); i++) {
-            std::string nextPart = parseExpression(andParts[i], target + "_and" + std::to_string(i), circuit, tempCounter);
-            std::string tempName = (i == andParts.size() - 1) ? target : generateTempName(target + "_and", tempCounter);
+            std::string nextPart = parseExpression(andParts[i], circuit.newTemp(), circuit);
+            std::string tempName = (i == andParts.size() - 1) ? target : circuit.newTemp();
             circuit.addGate(Gate(Gate::Type::AND, {current, nextPart}, tempName));
             current = tempName;
         }
         return target;
     }
-    
-    // otherwise this is a simple signal name (or bit)
-    return cleaned;
+    
+    // Comparisons bind tighter than the bitwise operators split above: equality first,
+    // then magnitude. '<' and '>' next to another '<' / '>' belong to a shift.
+    parenCount = 0;
+    size_t relPos = std::string::npos, relLen = 0;
+    for (size_t i = 1; i + 1 < cleaned.size(); i++) {
+        char c = cleaned[i];
+        if (c == '(') parenCount++;
+        else if (c == ')') parenCount--;
+        if (parenCount != 0) continue;
+        if ((c == '=' || c == '!') && cleaned[i + 1] == '=') {
+            relPos = i;
+            relLen = 2;
+            break;
+        }
+        if ((c == '<' || c == '>') && relPos == std::string::npos && cleaned[i - 1] != c && cleaned[i + 1] != c) {
+            relPos = i;
+            relLen = cleaned[i + 1] == '=' ? 2 : 1;
+        }
+    }
+    if (relPos != std::string::npos && relPos + relLen < cleaned.size()) {
+        return generateComparator(cleaned.substr(relPos, relLen), cleaned.substr(0, relPos),
+                                  cleaned.substr(relPos + relLen), target, circuit);
+    }
+
+    // Unary NOT binds tightest: only reached once no binary operator is left at the top
+    if (cleaned[0] == '~' || cleaned[0] == '!') {
+        std::string operand = cleaned.substr(1);
+        std::string operandParsed = parseExpression(operand, circuit.newTemp(), circuit);
+        circuit.addGate(Gate(Gate::Type::NOT, {operandParsed}, target));
+        return target;
+    }
+
+    // A literal in a single-bit context is its LSB
+    std::vector<bool> value;
+    if (literalValue(cleaned, value)) return constantNet(!value.empty() && value[0]);
+
+    // otherwise this is a simple signal name (or bit); a brace left here is a concatenation
+    // the word level could not parse, not a name
+    if (cleaned.find_first_of("{}") != std::string::npos) {
+        throw std::runtime_error("Unsupported concatenation: " + cleaned);
+    }
+    return cleaned;
+}
+
+std::string VerilogParser::generateAdder(const std::string& leftOp, const std::string& rightOp, 
+                           const std::string& target, LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG ADDER: Generating " << ArithmeticBuilder::architectureName(adderArchitecture)
+                           << " adder for " << leftOp << " + " << rightOp << " -> " << target << std::endl;
+    
+    if (isVectorBase(target, circuit)) {
+        std::vector<std::string> targetBits = getVectorBits(target, circuit);
+        std::vector<std::string> leftBits = getVectorBits(leftOp, circuit);
+        std::vector<std::string> rightBits = getVectorBits(rightOp, circuit);
+        
+        if (targetBits.empty() || leftBits.empty() || rightBits.empty()) {
+            throw std::runtime_error("Cannot find vector bits for addition operands");
+        }
+        
+        if (leftBits.size() != targetBits.size() || rightBits.size() != targetBits.size()) {
+            throw std::runtime_error("Vector width mismatch in addition");
+        }
+        
+        // getVectorBits is MSB first, the builder wants LSB first
+        std::reverse(targetBits.begin(), targetBits.end());
+        std::reverse(leftBits.begin(), leftBits.end());
+        std::reverse(rightBits.begin(), rightBits.end());
+        ArithmeticBuilder::add(circuit, leftBits, rightBits, false, targetBits, adderArchitecture);
+        return target;
+    } else {
+        throw std::runtime_error("Scalar addition not yet supported - use vector types");
+    }
+}
+
+std::string VerilogParser::generateSubtractor(const std::string& leftOp, const std::string& rightOp,
+                                const std::string& target, LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG SUBTRACTOR: Generating " << ArithmeticBuilder::architectureName(adderArchitecture)
+                           << " subtractor for " << leftOp << " - " << rightOp << " -> " << target << std::endl;
+    
+    if (isVectorBase(target, circuit)) {
+        std::vector<std::string> targetBits = getVectorBits(target, circuit);
+        std::vector<std::string> leftBits = getVectorBits(leftOp, circuit);
+        std::vector<std::string> rightBits = getVectorBits(rightOp, circuit);
+        
+        if (targetBits.empty() || leftBits.empty() || rightBits.empty()) {
+            throw std::runtime_error("Cannot find vector bits for subtraction operands");
+        }
+        
+        if (leftBits.size() != targetBits.size() || rightBits.size() != targetBits.size()) {
+            throw std::runtime_error("Vector width mismatch in subtraction");
+        }
+        
+        // a - b = a + ~b + 1
+        std::reverse(targetBits.begin(), targetBits.end());
+        std::reverse(leftBits.begin(), leftBits.end());
+        std::vector<std::string> rightInverted(rightBits.size());
+        for (size_t i = 0; i < rightBits.size(); i++) {
+            rightInverted[i] = circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::NOT, {rightBits[rightBits.size() - 1 - i]}, rightInverted[i]));
+        }
+        ArithmeticBuilder::add(circuit, leftBits, rightInverted, true, targetBits, adderArchitecture);
+        return target;
+    } else {
+        throw std::runtime_error("Scalar subtraction not yet supported - use vector types");
+    }
+}
+
+std::string VerilogParser::generateMultiplier(const std::string& leftOp, const std::string& rightOp,
+                                             const std::string& target, LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG MULTIPLIER: Generating " << ArithmeticBuilder::architectureName(multiplierArchitecture)
+                           << " multiplier for " << leftOp << " * " << rightOp << " -> " << target << std::endl;
+
+    if (isVectorBase(target, circuit)) {
+        std::vector<std::string> targetBits = getVectorBits(target, circuit);
+        std::vector<std::string> leftBits = getVectorBits(leftOp, circuit);
+        std::vector<std::string> rightBits = getVectorBits(rightOp, circuit);
+
+        if (targetBits.empty() || leftBits.empty() || rightBits.empty()) {
+            throw std::runtime_error("Cannot find vector bits for multiplication operands");
+        }
+
+        // Operands may differ in width; the product is truncated to the target width
+        std::reverse(targetBits.begin(), targetBits.end());
+        std::reverse(leftBits.begin(), leftBits.end());
+        std::reverse(rightBits.begin(), rightBits.end());
+        ArithmeticBuilder::multiply(circuit, leftBits, rightBits, targetBits, multiplierArchitecture,
+                                    canonicalPartialProducts, adderArchitecture);
+        return target;
+    } else {
+        throw std::runtime_error("Scalar multiplication not yet supported - use vector types");
+    }
+}
+
+std::string VerilogParser::generateShifter(const std::string& op, const std::string& leftOp,
+                                           const std::string& rightOp, const std::string& target,
+                                           LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG SHIFTER: " << leftOp << " " << op << " " << rightOp << " -> " << target
+                           << std::endl;
+    if (!isVectorBase(target, circuit) || !isVectorBase(leftOp, circuit)) {
+        throw std::runtime_error("Scalar shift not yet supported - use vector types");
+    }
+    using ShiftKind = ArithmeticBuilder::ShiftKind;
+    // Without signed types >>> is a logical shift, like >>
+    ShiftKind kind = op[0] == '<' ? ShiftKind::LEFT : ShiftKind::RIGHT;
+    std::vector<std::string> targetBits = getVectorBits(target, circuit);
+    std::vector<std::string> leftBits = getVectorBits(leftOp, circuit);
+    std::reverse(targetBits.begin(), targetBits.end());
+    std::reverse(leftBits.begin(), leftBits.end());
+
+    uint64_t amount;
+    if (parseIntegerLiteral(rightOp, amount)) {
+        ArithmeticBuilder::shift(circuit, leftBits, amount, kind, targetBits);
+    } else {
+        ArithmeticBuilder::shift(circuit, leftBits, operandBits(rightOp, circuit), kind, targetBits);
+    }
+    return target;
+}
+
+std::vector<std::string> VerilogParser::operandBits(const std::string& operand, LogicCircuit& circuit) {
+    if (isVectorBase(operand, circuit)) {
+        std::vector<std::string> bits = getVectorBits(operand, circuit);
+        std::reverse(bits.begin(), bits.end());
+        return bits;
+    }
+    std::vector<std::string> bits;
+    if (literalBits(trim(operand), bits)) {
+        std::reverse(bits.begin(), bits.end());
+        return bits;
+    }
+    return {parseExpression(operand, circuit.newTemp(), circuit)};
+}
+
+std::string VerilogParser::generateComparator(const std::string& op, const std::string& leftOp,
+                                              const std::string& rightOp, const std::string& target,
+                                              LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG COMPARATOR: " << leftOp << " " << op << " " << rightOp << " -> " << target
+                           << std::endl;
+    using Comparison = ArithmeticBuilder::Comparison;
+    Comparison comparison = op == "==" ? Comparison::EQ : op == "!=" ? Comparison::NE
+                          : op == "<"  ? Comparison::LT : op == "<=" ? Comparison::LE
+                          : op == ">"  ? Comparison::GT : Comparison::GE;
+    ArithmeticBuilder::compare(circuit, operandBits(leftOp, circuit), operandBits(rightOp, circuit), comparison,
+                               target, directComparators);
+    return target;
+}
+
+void VerilogParser::parseIO(const std::string& line, std::unordered_set<std::string>& container) {
+    std::string cleaned = line;
+    cleaned.erase(std::remove_if(cleaned.begin(), cleaned.end(),
+                                [](unsigned char c) { return c == ',' || c == ';'; }),
+                  cleaned.end());
+
+    std::stringstream ss(cleaned);
+    std::string word;
+    ss >> word;
+
+    std::string currentRange = "";
+    
+    while (ss >> word) {
+        // Every operand is unsigned: comparators, shifts and extension have no signed forms
+        if (word == "signed") throw std::runtime_error("Signed declarations not supported: " + trim(line));
+        if (word == "reg" || word == "wire" || word == "logic") continue;
+        if (word[0] == '[') {
+            currentRange = word;
+        } else {
+            if (!currentRange.empty()) {
+                std::string rangeClean = currentRange;
+                rangeClean.erase(std::remove(rangeClean.begin(), rangeClean.end(), '['), rangeClean.end());
+                rangeClean.erase(std::remove(rangeClean.begin(), rangeClean.end(), ']'), rangeClean.end());
+                size_t colonPos = rangeClean.find(':');
+                if (colonPos != std::string::npos) {
+                    int msb = std::stoi(rangeClean.substr(0, colonPos));
+                    int lsb = std::stoi(rangeClean.substr(colonPos + 1));
+                    for (int i = msb; i >= lsb; --i) {
+                        container.insert(word + "[" + std::to_string(i) + "]");
+                    }
+                } else {
+                    container.insert(word + "[" + rangeClean + "]");
+                }
+                currentRange = "";
+            } else {
+                container.insert(word);
+            }
+        }
+    }
+}
+
+void VerilogParser::parseWireDeclaration(const std::string& line, LogicCircuit& circuit) {
+    std::string declaration = line, initializer;
+    size_t eq = line.find('=');
+    if (eq != std::string::npos) {
+        declaration = line.substr(0, eq);
+        initializer = line.substr(eq + 1);
+    }
+    std::unordered_set<std::string> bits;
+    parseIO(declaration, bits);
+    for (const auto& bit : bits) {
+        size_t open = bit.find('[');
+        if (open == std::string::npos) continue;
+        std::string name = bit.substr(0, open);
+        if (isVectorBase(name, circuit)) continue;
+        // Bits MSB first in declaration order: [7:0] and [0:7] alike
+        std::string range = declaration.substr(declaration.find('['));
+        int msb, lsb;
+        parseRange(range, msb, lsb);
+        std::vector<std::string>& vector = circuit.internalVectors[name];
+        for (int b = msb; msb >= lsb ? b >= lsb : b <= lsb; b += msb >= lsb ? -1 : 1) {
+            vector.push_back(name + "[" + std::to_string(b) + "]");
+        }
+    }
+    if (!initializer.empty()) {
+        // The initialized net is the last name declared
+        WordTokens tokens = wordTokens(declaration);
+        if (tokens.empty() || !isIdentifier(tokens.back())) {
+            throw std::runtime_error("Malformed wire declaration: " + trim(line));
+        }
+        parseAssignment("assign " + tokens.back() + " = " + initializer, circuit);
+    }
+}
+
+void VerilogParser::parseAssignment(const std::string& line, LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG ASSIGN: Raw line = \"" << line << "\"" << std::endl;
+    
+    std::string cleaned = line;
+    cleaned.erase(std::remove(cleaned.begin(), cleaned.end(), ';'), cleaned.end());
+    
+    // The first '=' is the assignment (the LHS holds no operators); "<=" there is a
+    // non-blocking assignment, any later one a comparison
+    size_t pos = cleaned.find('=');
+    bool isNonBlocking = pos != std::string::npos && pos > 0 && cleaned[pos - 1] == '<';
+    if (isNonBlocking) pos--;
+    
+    if (pos == std::string::npos) {
+        if (verbose) std::cout << "DEBUG ASSIGN: No assignment operator found, skipping line" << std::endl;
+        return;
+    }
+
+    std::string lhs = cleaned.substr(0, pos);
+    std::string rhs = cleaned.substr(pos + (isNonBlocking ? 2 : 1));
+
+    if (lhs.find("assign") != std::string::npos) {
+        size_t assignPos = lhs.find("assign");
+        lhs = lhs.substr(assignPos + 6);
+    }
+
+    lhs = trim(lhs);
+    rhs = trim(rhs);
+
+    if (lhs.empty() || rhs.empty()) {
+        return;
+    }
+
+    // Concatenation target: split the value of the RHS over the listed bits
+    if (lhs[0] == '{') {
+        std::vector<std::string> targets = targetBits(lhs, circuit);
+        if (assignWord(targets, rhs, circuit)) return;
+        std::string word = newVector(targets.size(), circuit);
+        parseAssignment("assign " + word + " = " + rhs + ";", circuit);
+        const std::vector<std::string>& nets = circuit.internalVectors[word];
+        for (size_t k = 0; k < targets.size(); k++) circuit.addGate(Gate(Gate::Type::BUF, {nets[k]}, targets[k]));
+        return;
+    }
+
+    // KEY FIX: Check if LHS has bracket but determine if it's bit-select or range
+    auto lhsBracketPos = lhs.find('[');
+    bool lhsHasBracket = (lhsBracketPos != std::string::npos);
+    bool lhsHasColon = (lhsHasBracket && lhs.find(':', lhsBracketPos) != std::string::npos);
+    
+    // Bit-select: has '[' but NO ':' (e.g., out[0])
+    // Range: has '[' AND ':' (e.g., out[7:0])
+    bool lhsIsBitSelect = lhsHasBracket && !lhsHasColon;
+    bool lhsIsRange = lhsHasBracket && lhsHasColon;
+    
+    // For bit-selects from generate loops, process directly
+    if (lhsIsBitSelect) {
+        if (verbose) std::cout << "DEBUG ASSIGN: Detected bit-select LHS: " << lhs << std::endl;
+        driveSignal(rhs, lhs, circuit);
+        return;
+    }
+
+    auto rhsBracketPos = rhs.find('[');
+    bool rhsHasBracket = (rhsBracketPos != std::string::npos);
+    bool rhsHasColon = (rhsHasBracket && rhs.find(':', rhsBracketPos) != std::string::npos);
+    
+    bool rhsIsRange = rhsHasBracket && rhsHasColon;
+
+    if (lhsIsRange && assignWord(targetBits(lhs, circuit), rhs, circuit)) {
+        if (verbose) std::cout << "DEBUG ASSIGN: Part-select target through the word graph" << std::endl;
+    }
+    // Handle range-to-range assignment
+    else if (lhsIsRange && rhsIsRange) {
+        if (verbose) std::cout << "DEBUG ASSIGN: Range-to-range assignment" << std::endl;
+        int lhsMsb, lhsLsb, rhsMsb, rhsLsb;
+        parseRange(lhs, lhsMsb, lhsLsb);
+        parseRange(rhs, rhsMsb, rhsLsb);
+
+        if ((lhsMsb - lhsLsb) != (rhsMsb - rhsLsb)) {
+            throw std::runtime_error("Vector width mismatch in assignment");
+        }
+
+        int width = lhsMsb - lhsLsb + 1;
+        for (int i = 0; i < width; ++i) {
+            std::string lhsBit = lhs.substr(0, lhsBracketPos) + "[" + std::to_string(lhsMsb - i) + "]";
+            std::string rhsBit = rhs.substr(0, rhsBracketPos) + "[" + std::to_string(rhsMsb - i) + "]";
+            driveSignal(rhsBit, lhsBit, circuit);
+        }
+    }
+    else if (isVectorBase(lhs, circuit)) {
+        if (verbose) std::cout << "DEBUG ASSIGN: Vector base assignment" << std::endl;
+        std::vector<std::string> lhsBits = getVectorBits(lhs, circuit);
+        if (assignWord(lhsBits, rhs, circuit)) return;
+        // Split the RHS once, then instantiate it for every bit position
+        std::unordered_map<std::string, std::vector<std::string>> vectors = getSourceVectors(circuit);
+        BitTemplate bitTemplate = makeBitTemplate(rhs, vectors, lhsBits.size());
+        // Vector arithmetic drives the whole LHS vector from its first instance
+        bool arithmetic = isVectorArithmetic(rhs);
+
+        for (size_t k = 0; k < lhsBits.size(); k++) {
+            if (arithmetic && circuit.isDriven(lhsBits[k])) continue;
+            driveSignal(bitTemplate.instantiate(k), lhsBits[k], circuit);
+        }
+    } else {
+        if (verbose) std::cout << "DEBUG ASSIGN: Simple assignment" << std::endl;
+        // A scalar computed from whole vectors (a == b, {a, b} < c, ^a, ...) is a word
+        // operation too
+        if (isWordExpression(rhs, circuit) && assignWord({lhs}, rhs, circuit)) return;
+        driveSignal(rhs, lhs, circuit);
+    }
+}
+
+void VerilogParser::driveSignal(const std::string& rhs, const std::string& lhs, LogicCircuit& circuit) {
+    std::string result = parseExpression(rhs, lhs, circuit);
+    // A bare signal on the right creates no gate of its own: connect it explicitly
+    if (!result.empty() && result != lhs) {
+        circuit.addGate(Gate(Gate::Type::BUF, {result}, lhs));
+    }
+}
+
+bool VerilogParser::parseWordTerm(const WordTokens& tokens, size_t& pos, int level, WordTerm& term,
+                                  const LogicCircuit& circuit) {
+    static const std::vector<std::vector<std::string>> binaryLevels = {
+        {"|"}, {"^", "~^", "^~"}, {"&"}, {"==", "!="}, {"<", "<=", ">", ">="}, {"<<", ">>", ">>>"}, {"+", "-"}, {"*"}};
+    static const std::string end;
+    auto peek = [&]() -> const std::string& { return pos < tokens.size() ? tokens[pos] : end; };
+
+    if (level == 0) {
+        WordTerm condition;
+        if (!parseWordTerm(tokens, pos, 1, condition, circuit)) return false;
+        if (peek() != "?") {
+            term = std::move(condition);
+            return true;
+        }
+        pos++;
+        WordTerm then, otherwise;
+        if (!parseWordTerm(tokens, pos, 0, then, circuit) || peek() != ":") return false;
+        pos++;
+        if (!parseWordTerm(tokens, pos, 0, otherwise, circuit)) return false;
+        term = WordTerm();
+        term.kind = WordTerm::Kind::TERNARY;
+        term.width = std::max(then.width, otherwise.width);
+        term.args = {std::move(condition), std::move(then), std::move(otherwise)};
+        return true;
+    }
+    if (level <= static_cast<int>(binaryLevels.size())) {
+        const std::vector<std::string>& ops = binaryLevels[level - 1];
+        if (!parseWordTerm(tokens, pos, level + 1, term, circuit)) return false;
+        while (std::find(ops.begin(), ops.end(), peek()) != ops.end()) {
+            WordTerm node, right;
+            node.kind = WordTerm::Kind::BINARY;
+            node.op = tokens[pos++];
+            if (!parseWordTerm(tokens, pos, level + 1, right, circuit)) return false;
+            bool shift = node.op == "<<" || node.op == ">>" || node.op == ">>>";
+            bool comparison = !shift && (node.op[0] == '<' || node.op[0] == '>' || node.op[1] == '=');
+            node.width = comparison ? 1 : shift ? term.width : std::max(term.width, right.width);
+            node.args = {std::move(term), std::move(right)};
+            term = std::move(node);
+        }
+        return true;
+    }
+
+    // Unary operators and primaries
+    const std::string& token = peek();
+    if (isReduction(token)) {
+        // &a, |a, ^a and their negations: one bit of a self-determined operand
+        pos++;
+        WordTerm operand;
+        if (!parseWordTerm(tokens, pos, level, operand, circuit)) return false;
+        term = WordTerm();
+        term.kind = WordTerm::Kind::UNARY;
+        term.op = token;
+        term.width = 1;
+        term.args = {std::move(operand)};
+        return true;
+    }
+    if (token == "~" || token == "-" || token == "+") {
+        pos++;
+        WordTerm operand;
+        if (!parseWordTerm(tokens, pos, level, operand, circuit)) return false;
+        term = WordTerm();
+        term.kind = WordTerm::Kind::UNARY;
+        term.op = token;
+        term.width = operand.width;
+        term.args = {std::move(operand)};
+        return true;
+    }
+    if (token == "(") {
+        pos++;
+        if (!parseWordTerm(tokens, pos, 0, term, circuit) || peek() != ")") return false;
+        pos++;
+        return true;
+    }
+    if (token == "{") {
+        // {a, b, ...} or the replication {N{a, b, ...}}; parts are self-determined
+        pos++;
+        WordTerm first;
+        if (!parseWordTerm(tokens, pos, 0, first, circuit)) return false;
+        std::vector<WordTerm> parts;
+        if (peek() == "{" && first.kind == WordTerm::Kind::LITERAL) {
+            WordTerm repeated;
+            if (!parseWordTerm(tokens, pos, level, repeated, circuit) || peek() != "}") return false;
+            if (first.value == 0 || first.value > 4096 || first.value * repeated.width > 4096) return false;
+            for (uint64_t r = 0; r < first.value; r++) parts.push_back(repeated);
+        } else {
+            parts.push_back(std::move(first));
+            while (peek() == ",") {
+                pos++;
+                parts.emplace_back();
+                if (!parseWordTerm(tokens, pos, 0, parts.back(), circuit)) return false;
+            }
+            if (peek() != "}") return false;
+        }
+        pos++;
+        term = WordTerm();
+        term.kind = WordTerm::Kind::CONCAT;
+        for (const WordTerm& part : parts) term.width += part.width;
+        term.args = std::move(parts);
+        return true;
+    }
+    if (!token.empty() && (isdigit(static_cast<unsigned char>(token[0])) || token[0] == '\'')) {
+        std::vector<bool> value;
+        if (!literalValue(token, value)) return false;
+        // Unsized literals are 32 bits wide
+        size_t tick = token.find('\'');
+        size_t width = tick == std::string::npos || tick == 0 ? 32 : std::stoul(token.substr(0, tick));
+        if (width == 0) return false;
+        term = WordTerm();
+        term.width = width;
+        if (width > 64) {
+            // Too wide for a word constant: a leaf of constant nets
+            term.kind = WordTerm::Kind::SIGNAL;
+            for (size_t i = 0; i < width; i++) term.bits.push_back(constantNet(i < value.size() && value[i]));
+        } else {
+            term.kind = WordTerm::Kind::LITERAL;
+            for (size_t i = 0; i < width && i < value.size(); i++) term.value |= uint64_t(value[i]) << i;
+        }
+        pos++;
+        return true;
+    }
+    if (!isIdentifier(token)) return false;
+    term = WordTerm();
+    term.kind = WordTerm::Kind::SIGNAL;
+    pos++;
+    if (peek() == "[") {
+        // Bit- or part-select with constant indices: a view of the selected bits
+        auto number = [](const std::string& index) {
+            return !index.empty() && std::all_of(index.begin(), index.end(), [](unsigned char c) { return isdigit(c); });
+        };
+        if (pos + 2 < tokens.size() && tokens[pos + 2] == "]" && number(tokens[pos + 1])) {
+            term.bits = {token + "[" + tokens[pos + 1] + "]"};
+            pos += 3;
+        } else if (pos + 4 < tokens.size() && tokens[pos + 2] == ":" && tokens[pos + 4] == "]" &&
+                   number(tokens[pos + 1]) && number(tokens[pos + 3])) {
+            int msb = std::stoi(tokens[pos + 1]), lsb = std::stoi(tokens[pos + 3]);
+            for (int b = lsb; msb >= lsb ? b <= msb : b >= msb; b += msb >= lsb ? 1 : -1) {
+                term.bits.push_back(token + "[" + std::to_string(b) + "]");
+            }
+            pos += 5;
+        } else {
+            return false;
+        }
+    } else if (isVectorBase(token, circuit)) {
+        term.bits = getVectorBits(token, circuit);
+        std::reverse(term.bits.begin(), term.bits.end());
+    } else {
+        term.bits = {token};
+    }
+    term.width = term.bits.size();
+    return true;
+}
+
+int VerilogParser::lowerWordTerm(const WordTerm& term, size_t width, WordGraph& graph) {
+    using Op = WordGraph::Op;
+    switch (term.kind) {
+    case WordTerm::Kind::SIGNAL:
+        return graph.resize(graph.leaf(term.bits), width);
+    case WordTerm::Kind::LITERAL:
+        return graph.constant(term.value, width);
+    case WordTerm::Kind::UNARY: {
+        if (isReduction(term.op)) {
+            const WordTerm& a = term.args[0];
+            Op op = term.op.back() == '&' ? Op::REDAND : term.op.back() == '|' ? Op::REDOR : Op::REDXOR;
+            int bit = graph.reduce(op, lowerWordTerm(a, a.width, graph));
+            if (term.op.size() > 1) bit = graph.unary(Op::NOT, bit);
+            return graph.resize(bit, width);
+        }
+        int operand = lowerWordTerm(term.args[0], width, graph);
+        if (term.op == "~") return graph.unary(Op::NOT, operand);
+        if (term.op == "-") return graph.binary(Op::SUB, graph.constant(0, width), operand);
+        return operand;
+    }
+    case WordTerm::Kind::TERNARY: {
+        const WordTerm& c = term.args[0];
+        int condition = lowerWordTerm(c, c.width, graph);
+        // A vector condition is true when any bit is set
+        if (c.width > 1) condition = graph.binary(Op::NE, condition, graph.constant(0, c.width));
+        return graph.mux(condition, lowerWordTerm(term.args[2], width, graph), lowerWordTerm(term.args[1], width, graph));
+    }
+    case WordTerm::Kind::CONCAT: {
+        std::vector<int> parts;
+        for (const WordTerm& part : term.args) parts.push_back(lowerWordTerm(part, part.width, graph));
+        return graph.resize(graph.concat(parts), width);
+    }
+    case WordTerm::Kind::BINARY:
+        break;
+    }
+    static const std::unordered_map<std::string, Op> ops = {
+        {"&", Op::AND}, {"|", Op::OR}, {"^", Op::XOR}, {"~^", Op::XNOR}, {"^~", Op::XNOR}, {"+", Op::ADD},
+        {"-", Op::SUB}, {"*", Op::MUL}, {"==", Op::EQ}, {"!=", Op::NE}, {"<", Op::LT}, {"<=", Op::LE},
+        {">", Op::GT}, {">=", Op::GE}, {"<<", Op::SHL}, {">>", Op::SHR}, {">>>", Op::SHR}};
+    const WordTerm& a = term.args[0];
+    const WordTerm& b = term.args[1];
+    Op op = ops.at(term.op);
+    if (op == Op::EQ || op == Op::NE || op == Op::LT || op == Op::LE || op == Op::GT || op == Op::GE) {
+        // Comparison operands are sized against each other, not against the context
+        size_t operandWidth = std::max(a.width, b.width);
+        int result = graph.binary(op, lowerWordTerm(a, operandWidth, graph), lowerWordTerm(b, operandWidth, graph));
+        return graph.resize(result, width);
+    }
+    if (op == Op::SHL || op == Op::SHR) {
+        // The amount is self-determined
+        return graph.binary(op, lowerWordTerm(a, width, graph), lowerWordTerm(b, b.width, graph));
+    }
+    return graph.binary(op, lowerWordTerm(a, width, graph), lowerWordTerm(b, width, graph));
+}
+
+bool VerilogParser::isWordExpression(const std::string& rhs, const LogicCircuit& circuit) {
+    WordTokens tokens = wordTokens(rhs);
+    for (size_t i = 0; i < tokens.size(); i++) {
+        bool wholeVector = isIdentifier(tokens[i]) && isVectorBase(tokens[i], circuit) &&
+                           (i + 1 == tokens.size() || tokens[i + 1] != "[");
+        bool partSelect = tokens[i] == "[" && i + 2 < tokens.size() && tokens[i + 2] == ":";
+        // A reduction stands where an operand starts, a binary operator after one
+        bool operandStart = i == 0 || tokens[i - 1] == "(" || tokens[i - 1] == "{" || tokens[i - 1] == "," ||
+                            (!isalnum(static_cast<unsigned char>(tokens[i - 1].back())) &&
+                             tokens[i - 1].back() != '_' && tokens[i - 1] != ")" && tokens[i - 1] != "]" &&
+                             tokens[i - 1] != "}");
+        if (wholeVector || partSelect || tokens[i] == "{" || (isReduction(tokens[i]) && operandStart)) return true;
+    }
+    return false;
+}
+
+bool VerilogParser::assignWord(const std::vector<std::string>& targets, const std::string& rhs, LogicCircuit& circuit) {
+    if (!wordGraph || targets.empty()) return false;
+    WordTokens tokens = wordTokens(rhs);
+    size_t pos = 0;
+    WordTerm term;
+    if (!parseWordTerm(tokens, pos, 0, term, circuit) || pos != tokens.size()) return false;
+    // Context-determined operands are evaluated at the wider of target and expression
+    int node = lowerWordTerm(term, std::max(targets.size(), term.width), *wordGraph);
+    node = wordGraph->resize(node, targets.size());
+    if (verbose) std::cout << "DEBUG WORD: " << rhs << " -> node " << node << " (" << targets.size() << " bits)"
+                           << std::endl;
+    for (size_t k = 0; k < targets.size(); k++) wordGraph->define(targets[targets.size() - 1 - k], node, k);
+    return true;
+}
+
+void VerilogParser::parseRange(const std::string& s, int& msb, int& lsb) {
+    size_t lb = s.find('['), rb = s.find(']');
+    std::string r = s.substr(lb+1, rb-lb-1);
+    size_t colonPos = r.find(':');
+    msb = std::stoi(r.substr(0, colonPos));
+    lsb = std::stoi(r.substr(colonPos+1));
+}
+
+std::string VerilogParser::extractBaseName(const std::string& signal) {
+    size_t pos = signal.find('[');
+    if (pos != std::string::npos) {
+        return signal.substr(0, pos);
+    }
+    return signal;
+}
+
+bool VerilogParser::isVectorBase(const std::string& name, const LogicCircuit& circuit) {
+    if (circuit.internalVectors.count(name)) return true;
+    for (const auto& signal : circuit.inputs) {
+        if (signal.length() > name.length() + 2 && 
+            signal.substr(0, name.length()) == name && 
+            signal[name.length()] == '[') {
+            return true;
+        }
+    }
+    for (const auto& signal : circuit.outputs) {
+        if (signal.length() > name.length() + 2 && 
+            signal.substr(0, name.length()) == name && 
+            signal[name.length()] == '[') {
+            return true;
+        }
+    }
+    for (const auto& signal : circuit.registers) {
+        if (signal.length() > name.length() + 2 && 
+            signal.substr(0, name.length()) == name && 
+            signal[name.length()] == '[') {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> VerilogParser::getVectorBits(const std::string& baseName, const LogicCircuit& circuit) {
+    auto internal = circuit.internalVectors.find(baseName);
+    if (internal != circuit.internalVectors.end()) return internal->second;
+    std::vector<std::string> bits;
+    
+    for (const auto& signal : circuit.outputs) {
+        if (signal.length() > baseName.length() + 2 && 
+            signal.substr(0, baseName.length()) == baseName && 
+            signal[baseName.length()] == '[') {
+            bits.push_back(signal);
+        }
+    }
+    
+    if (bits.empty()) {
+        for (const auto& signal : circuit.inputs) {
+            if (signal.length() > baseName.length() + 2 && 
+                signal.substr(0, baseName.length()) == baseName && 
+                signal[baseName.length()] == '[') {
+                bits.push_back(signal);
+            }
+        }
+    }
+    
+    if (bits.empty()) {
+        for (const auto& signal : circuit.registers) {
+            if (signal.length() > baseName.length() + 2 && 
+                signal.substr(0, baseName.length()) == baseName && 
+                signal[baseName.length()] == '[') {
+                bits.push_back(signal);
+            }
+        }
+    }
+    
+    std::sort(bits.begin(), bits.end(), [](const std::string& a, const std::string& b) {
+        size_t a_start = a.find('[') + 1;
+        size_t a_end = a.find(']', a_start);
+        size_t b_start = b.find('[') + 1;
+        size_t b_end = b.find(']', b_start);
+        
+        if (a_start != std::string::npos && a_end != std::string::npos && 
+            b_start != std::string::npos && b_end != std::string::npos) {
+            int a_idx = std::stoi(a.substr(a_start, a_end - a_start));
+            int b_idx = std::stoi(b.substr(b_start, b_end - b_start));
+            return a_idx > b_idx;
+        }
+        return a < b;
+    });
+    
+    return bits;
+}
+
+std::unordered_map<std::string, std::vector<std::string>> VerilogParser::getSourceVectors(const LogicCircuit& circuit) {
+    std::unordered_map<std::string, std::vector<std::pair<int, std::string>>> indexed;
+    for (const auto* declared : {&circuit.inputs, &circuit.registers}) {
+        for (const auto& in : *declared) {
+            size_t open = in.find('['), close = in.find(']');
+            if (open == std::string::npos || close == std::string::npos || close < open) continue;
+            indexed[in.substr(0, open)].push_back({std::stoi(in.substr(open + 1, close - open - 1)), in});
+        }
+    }
+    std::unordered_map<std::string, std::vector<std::string>> vectors = circuit.internalVectors;
+    for (auto& entry : indexed) {
+        std::sort(entry.second.begin(), entry.second.end(),
+                  [](const std::pair<int, std::string>& a, const std::pair<int, std::string>& b) { return a.first > b.first; });
+        std::vector<std::string>& bits = vectors[entry.first];
+        if (!bits.empty()) continue;
+        for (const auto& bit : entry.second) bits.push_back(bit.second);
+    }
+    return vectors;
+}
+
+std::string VerilogParser::newVector(size_t width, LogicCircuit& circuit) {
+    std::string base = circuit.newTemp();
+    std::vector<std::string>& bits = circuit.internalVectors[base];
+    for (size_t i = width; i-- > 0;) bits.push_back(base + "[" + std::to_string(i) + "]");
+    return base;
+}
+
+VerilogParser::BitTemplate VerilogParser::makeBitTemplate(
+        const std::string& expr, const std::unordered_map<std::string, std::vector<std::string>>& vectors,
+        size_t width) {
+    auto identChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$'; };
+    bool arithmetic = isVectorArithmetic(expr);
+    BitTemplate t;
+    t.text.push_back("");
+    for (size_t i = 0; i < expr.size();) {
+        if (!identChar(expr[i])) {
+            t.text.back() += expr[i++];
+            continue;
+        }
+        size_t end = i;
+        while (end < expr.size() && identChar(expr[end])) end++;
+        std::string word = expr.substr(i, end - i);
+        // A sized literal wider than one bit slices like a vector of constants, extended
+        // or truncated to `width` (not in arithmetic, whose operands the builders read whole)
+        if (isdigit(static_cast<unsigned char>(word[0])) && end < expr.size() && expr[end] == '\'' && !arithmetic) {
+            size_t literalEnd = end + 1;
+            while (literalEnd < expr.size() && (identChar(expr[literalEnd]) || expr[literalEnd] == '\'')) literalEnd++;
+            auto bits = std::make_unique<std::vector<std::string>>();
+            if (literalBits(expr.substr(i, literalEnd - i), *bits) && bits->size() > 1) {
+                if (bits->size() > width) bits->erase(bits->begin(), bits->end() - width);
+                bits->insert(bits->begin(), width - bits->size(), LogicCircuit::kConst0);
+                t.slotBase.push_back(LogicCircuit::kConst0);
+                t.slotBits.push_back(bits.get());
+                t.literals.push_back(std::move(bits));
+                t.text.push_back("");
+                i = literalEnd;
+                continue;
+            }
+        }
+        // Whole vector names only: not a bit-select, not part of a sized literal
+        auto v = vectors.find(word);
+        bool slot = v != vectors.end() && (end >= expr.size() || expr[end] != '[') && (i == 0 || expr[i - 1] != '\'');
+        if (slot) {
+            t.slotBase.push_back(word);
+            t.slotBits.push_back(&v->second);
+            t.text.push_back("");
+        } else {
+            t.text.back() += word;
+        }
+        i = end;
+    }
+    return t;
+}
+
+std::string VerilogParser::BitTemplate::instantiate(size_t bit) const {
+    std::string result = text[0];
+    for (size_t s = 0; s < slotBits.size(); s++) {
+        // Narrower operands keep their name past their last bit, as before
+        result += bit < slotBits[s]->size() ? (*slotBits[s])[bit] : slotBase[s];
+        result += text[s + 1];
+    }
+    return result;
+}
+
+int VerilogParser::getVectorWidth(const std::string& baseName, const LogicCircuit& circuit) {
+    auto internal = circuit.internalVectors.find(baseName);
+    if (internal != circuit.internalVectors.end()) return static_cast<int>(internal->second.size());
+    int width = 0;
+    for (const auto& out : circuit.outputs) {
+        if (out.find(baseName + "[") == 0) {
+            width++;
+        }
+    }
+    if (width == 0) {
+        for (const auto& in : circuit.inputs) {
+            if (in.find(baseName + "[") == 0) {
+                width++;
+            }
+        }
+    }
+    if (width == 0) {
+        for (const auto& reg : circuit.registers) {
+            if (reg.find(baseName + "[") == 0) {
+                width++;
+            }
+        }
+    }
+    return width;
+}
+
+namespace {
+
+bool isIdentChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$'; }
+
+// Identifier starting at pos, empty if there is none
+std::string wordAt(const std::string& text, size_t pos) {
+    size_t end = pos;
+    while (end < text.size() && isIdentChar(text[end])) end++;
+    return text.substr(pos, end - pos);
+}
+
+void skipSpace(const std::string& text, size_t& pos) {
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+}
+
+// Text up to the first `stop` outside brackets; pos is left on the stop character
+std::string readUntil(const std::string& text, size_t& pos, char stop) {
+    size_t start = pos;
+    int depth = 0;
+    for (; pos < text.size(); pos++) {
+        char c = text[pos];
+        if (c == stop && depth == 0) return text.substr(start, pos - start);
+        if (c == '(' || c == '[' || c == '{') depth++;
+        else if (c == ')' || c == ']' || c == '}') depth--;
+    }
+    throw std::runtime_error(std::string("Missing '") + stop + "' in always block");
+}
+
+// Contents of the parenthesized group at pos; pos moves past it
+std::string readParenthesized(const std::string& text, size_t& pos) {
+    skipSpace(text, pos);
+    if (pos >= text.size() || text[pos] != '(') throw std::runtime_error("Expected '(' in always block");
+    pos++;
+    std::string inner = readUntil(text, pos, ')');
+    pos++;
+    return inner;
+}
+
+// Change of begin / case nesting over one line
+int blockNesting(const std::string& line, bool& opened) {
+    int delta = 0;
+    for (size_t i = 0; i < line.size();) {
+        if (!isIdentChar(line[i])) {
+            i++;
+            continue;
+        }
+        std::string word = wordAt(line, i);
+        if (word == "begin" || word == "case" || word == "casez" || word == "casex") {
+            delta++;
+            opened = true;
+        } else if (word == "end" || word == "endcase") {
+            delta--;
+        }
+        i += word.size();
+    }
+    return delta;
+}
+
+// Signal holding the next state of a register bit; the key of a non-blocking assignment
+std::string nextStateNet(const std::string& bit) { return "$next_" + bit; }
+
+bool isNextState(const std::string& net) { return net.compare(0, 6, "$next_") == 0; }
+
+// Value an unassigned bit keeps: a register keeps its current state, a latched bit its
+// previous value, an undriven net and so a free input of the circuit
+std::string holdNet(const std::string& bit) { return isNextState(bit) ? bit.substr(6) : "$prev_" + bit; }
+
+// MUXes a balanced tree over `leaf` (item index per select value) would need at most
+size_t muxCount(const std::vector<size_t>& leaf, size_t lo, size_t size) {
+    if (std::all_of(leaf.begin() + lo, leaf.begin() + lo + size, [&](size_t i) { return i == leaf[lo]; })) return 0;
+    return 1 + muxCount(leaf, lo, size / 2) + muxCount(leaf, lo + size / 2, size / 2);
+}
+
+} // namespace
+
+std::string VerilogParser::readVerilogBlock(std::ifstream& file, std::string& firstLine) {
+    // The block is the header's statement: complete once every begin / case is closed
+    // and the text ends a statement, unless the next line goes on with an else
+    std::string block = firstLine;
+    bool opened = false;
+    int depth = blockNesting(firstLine, opened);
+    auto complete = [&]() {
+        if (depth > 0) return false;
+        std::string text = trim(block);
+        size_t start = text.size();
+        while (start > 0 && isIdentChar(text[start - 1])) start--;
+        std::string last = text.substr(start);
+        return (!text.empty() && text.back() == ';') || last == "end" || last == "endcase";
+    };
+
+    std::string line;
+    while (true) {
+        if (complete()) {
+            std::streampos mark = file.tellg();
+            if (!std::getline(file, line)) break;
+            std::string next = trim(line);
+            if (wordAt(next, 0) != "else") {
+                file.seekg(mark);
+                break;
+            }
+        } else if (!std::getline(file, line)) {
+            break;
+        }
+        auto commentPos = line.find("//");
+        if (commentPos != std::string::npos) {
+            line = line.substr(0, commentPos);
+        }
+        depth += blockNesting(line, opened);
+        block += "\n" + line;
+    }
+
+    return block;
+}
+
+void VerilogParser::parseAlwaysBlock(const std::string& block, LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG ALWAYS: Processing always block" << std::endl;
+
+    size_t pos = block.find("always_comb");
+    bool clocked = false;
+    if (pos != std::string::npos) {
+        pos += 11;
+    } else {
+        pos = block.find("always_ff");
+        pos = block.find('@', pos == std::string::npos ? 0 : pos);
+        if (pos == std::string::npos) {
+            std::cout << "WARNING: Non-combinational always block skipped" << std::endl;
+            return;
+        }
+        pos++;
+        skipSpace(block, pos);
+        std::string events = block[pos] == '(' ? readParenthesized(block, pos) : std::string(1, block[pos++]);
+        // Every edge is the one clock of the frame: asynchronous resets are sampled like
+        // synchronous ones
+        clocked = events.find("posedge") != std::string::npos || events.find("negedge") != std::string::npos;
+        if (!clocked && trim(events) != "*") {
+            std::cout << "WARNING: Non-combinational always block skipped" << std::endl;
+            return;
+        }
+    }
+
+    Statement body = parseStatement(block, pos);
+    BitValues values;
+    if (clocked) {
+        // A blocking target of a clocked block is a register too: it starts out at its
+        // current state, and reads after the assignment see the new value
+        std::unordered_set<std::string> nonBlocking;
+        std::vector<const Statement*> pending = {&body};
+        while (!pending.empty()) {
+            const Statement* statement = pending.back();
+            pending.pop_back();
+            if (statement->kind == Statement::Kind::ASSIGN) {
+                for (const std::string& bit : targetBits(statement->lhs, circuit)) {
+                    if (statement->nonBlocking) nonBlocking.insert(bit);
+                    else values[bit] = {bit, false};
+                }
+            }
+            for (const Statement& child : statement->body) pending.push_back(&child);
+        }
+        // Both kinds on one bit would give it two next states
+        for (const auto& entry : values) {
+            if (nonBlocking.count(entry.first)) {
+                throw std::runtime_error("Register " + extractBaseName(entry.first) +
+                                         " has both blocking and non-blocking assignments");
+            }
+        }
+    }
+    executeStatement(body, values, circuit);
+
+    bool skipped = false;
+    for (const auto& entry : values) {
+        if (clocked) {
+            // The register bit becomes a state input of the frame, its next state a signal
+            std::string bit = isNextState(entry.first) ? entry.first.substr(6) : entry.first;
+            std::string next = nextStateNet(bit);
+            circuit.addGate(Gate(Gate::Type::BUF, {entry.second.net}, next));
+            circuit.latches[bit] = next;
+            circuit.inputs.insert(bit);
+            circuit.wires.insert(bit);
+            continue;
+        }
+        if (isNextState(entry.first)) {
+            if (!skipped) std::cout << "WARNING: Non-blocking assignment in combinational logic - skipped" << std::endl;
+            skipped = true;
+            continue;
+        }
+        if (entry.second.mayHold) {
+            std::cout << "WARNING: Latch inferred for " << entry.first << " - not assigned on every path, "
+                      << "previous value read from input " << holdNet(entry.first) << std::endl;
+        }
+        if (entry.second.net != entry.first) {
+            circuit.addGate(Gate(Gate::Type::BUF, {entry.second.net}, entry.first));
+        }
+    }
 }
 
-void VerilogParser::parseIO(const std::string& line, std::unordered_set<std::string>& container) {
-    std::string cleaned = line;
-    cleaned.erase(std::remove_if(cleaned.begin(), cleaned.end(),
-                                [](unsigned char c) { return c == ',' || c == ';'; }),
-                  cleaned.end());
-
-    std::stringstream ss(cleaned);
-    std::string word;
-    ss >> word;
+VerilogParser::Statement VerilogParser::parseStatement(const std::string& text, size_t& pos) {
+    Statement statement;
+    skipSpace(text, pos);
+    if (pos >= text.size()) throw std::runtime_error("Unexpected end of always block");
+    std::string word = wordAt(text, pos);
 
-    std::string currentRange = "";
-    
-    while (ss >> word) {
-        if (word[0] == '[') {
-            currentRange = word;
-        } else {
-            if (!currentRange.empty()) {
-                std::string rangeClean = currentRange;
-                rangeClean.erase(std::remove(rangeClean.begin(), rangeClean.end(), '['), rangeClean.end());
-                rangeClean.erase(std::remove(rangeClean.begin(), rangeClean.end(), ']'), rangeClean.end());
-                size_t colonPos = rangeClean.find(':');
-                if (colonPos != std::string::npos) {
-                    int msb = std::stoi(rangeClean.substr(0, colonPos));
-                    int lsb = std::stoi(rangeClean.substr(colonPos + 1));
-                    for (int i = msb; i >= lsb; --i) {
-                        container.insert(word + "[" + std::to_string(i) + "]");
-                    }
-                } else {
-                    container.insert(word + "[" + rangeClean + "]");
-                }
-                currentRange = "";
+    // unique / priority only add assertions about the if or case that follows
+    if (word == "unique" || word == "unique0" || word == "priority") {
+        pos += word.size();
+        return parseStatement(text, pos);
+    }
+    if (word == "begin") {
+        pos += word.size();
+        skipSpace(text, pos);
+        if (pos < text.size() && text[pos] == ':') {
+            pos++;
+            skipSpace(text, pos);
+            pos += wordAt(text, pos).size();
+        }
+        while (true) {
+            skipSpace(text, pos);
+            if (pos >= text.size()) throw std::runtime_error("Missing end in always block");
+            if (wordAt(text, pos) == "end") {
+                pos += 3;
+                break;
+            }
+            statement.body.push_back(parseStatement(text, pos));
+        }
+    } else if (word == "if") {
+        pos += word.size();
+        statement.kind = Statement::Kind::IF;
+        statement.expr = trim(readParenthesized(text, pos));
+        statement.body.push_back(parseStatement(text, pos));
+        skipSpace(text, pos);
+        if (wordAt(text, pos) == "else") {
+            pos += 4;
+            statement.body.push_back(parseStatement(text, pos));
+        }
+    } else if (word == "case" || word == "casez" || word == "casex") {
+        pos += word.size();
+        statement.kind = Statement::Kind::CASE;
+        statement.wildcards = word == "case" ? 0 : word.back();
+        statement.expr = trim(readParenthesized(text, pos));
+        while (true) {
+            skipSpace(text, pos);
+            if (pos >= text.size()) throw std::runtime_error("Missing endcase in always block");
+            std::string item = wordAt(text, pos);
+            if (item == "endcase") {
+                pos += item.size();
+                break;
+            }
+            std::vector<std::string> labels;
+            if (item == "default") {
+                pos += item.size();
+                skipSpace(text, pos);
+                if (pos < text.size() && text[pos] == ':') pos++;
             } else {
-                container.insert(word);
+                std::string list = readUntil(text, pos, ':') + ",";
+                pos++;
+                for (size_t at = 0; at < list.size(); at++) {
+                    std::string label = trim(readUntil(list, at, ','));
+                    if (!label.empty()) labels.push_back(label);
+                }
+                if (labels.empty()) throw std::runtime_error("Empty case item label in always block");
             }
+            statement.labels.push_back(labels);
+            statement.body.push_back(parseStatement(text, pos));
         }
+    } else if (text[pos] == ';') {
+        pos++;
+    } else {
+        std::string assignment = readUntil(text, pos, ';');
+        pos++;
+        // Anything else without an assignment ($display, ...) has no logic
+        size_t eq = assignment.find('=');
+        if (eq == std::string::npos) return statement;
+        statement.kind = Statement::Kind::ASSIGN;
+        statement.nonBlocking = eq > 0 && assignment[eq - 1] == '<';
+        statement.lhs = trim(assignment.substr(0, statement.nonBlocking ? eq - 1 : eq));
+        statement.expr = trim(assignment.substr(eq + 1));
     }
+    return statement;
 }
 
-void VerilogParser::parseAssignment(const std::string& line, LogicCircuit& circuit) {
-    std::string cleaned = line;
-    cleaned.erase(std::remove(cleaned.begin(), cleaned.end(), ';'), cleaned.end());
-
-    size_t pos = cleaned.find('=');
-    if (pos == std::string::npos) return;
-
-    std::string lhs = cleaned.substr(0, pos);
-    std::string rhs = cleaned.substr(pos + 1);
-
-    if (lhs.find("assign") != std::string::npos) {
-        size_t assignPos = lhs.find("assign");
-        lhs = lhs.substr(assignPos + 6);
+void VerilogParser::executeStatement(const Statement& statement, BitValues& values, LogicCircuit& circuit) {
+    switch (statement.kind) {
+    case Statement::Kind::BLOCK:
+        for (const Statement& child : statement.body) executeStatement(child, values, circuit);
+        break;
+    case Statement::Kind::ASSIGN: {
+        if (verbose) std::cout << "DEBUG ALWAYS: " << statement.lhs << " = " << statement.expr << std::endl;
+        std::vector<std::string> targets = targetBits(statement.lhs, circuit);
+        std::string rhs = substituteValues(statement.expr, values, circuit);
+        std::vector<std::string> nets;
+        if (targets.size() == 1 && !isWordExpression(rhs, circuit)) {
+            nets.push_back(parseExpression(rhs, circuit.newTemp(), circuit));
+        } else {
+            // The value goes to a fresh word; the targets take it over at the end of the block
+            std::string word = newVector(targets.size(), circuit);
+            parseAssignment("assign " + word + " = " + rhs + ";", circuit);
+            nets = circuit.internalVectors[word];
+        }
+        for (size_t k = 0; k < targets.size(); k++) {
+            values[statement.nonBlocking ? nextStateNet(targets[k]) : targets[k]] = {nets[k], false};
+        }
+        break;
     }
+    case Statement::Kind::IF: {
+        std::string condition = substituteValues(statement.expr, values, circuit);
+        std::string select;
+        if (isVectorBase(condition, circuit)) {
+            // A vector condition is true when any bit is set
+            select = circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::OR, getVectorBits(condition, circuit), select));
+        } else if (isWordExpression(condition, circuit)) {
+            std::string word = newVector(1, circuit);
+            parseAssignment("assign " + word + " = (" + condition + ") != 0;", circuit);
+            select = circuit.internalVectors[word][0];
+        } else {
+            select = parseExpression(condition, circuit.newTemp(), circuit);
+        }
+        BitValues taken = values, notTaken = values;
+        executeStatement(statement.body[0], taken, circuit);
+        if (statement.body.size() > 1) executeStatement(statement.body[1], notTaken, circuit);
 
-    auto trim = [](std::string& s) {
-        if (s.empty()) return;
-        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char c) { return !isspace(c); }));
-        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char c) { return !isspace(c); }).base(), s.end());
-    };
-    trim(lhs);
-    trim(rhs);
+        std::vector<std::string> bits;
+        for (const auto& entry : taken) bits.push_back(entry.first);
+        for (const auto& entry : notTaken) {
+            if (!taken.count(entry.first)) bits.push_back(entry.first);
+        }
+        for (const std::string& bit : bits) {
+            BitValue holdThen, holdElse;
+            const BitValue& t = valueOf(taken, bit, holdThen);
+            const BitValue& e = valueOf(notTaken, bit, holdElse);
+            BitValue merged{t.net, t.mayHold || e.mayHold};
+            if (t.net != e.net) {
+                merged.net = circuit.newTemp();
+                circuit.addGate(Gate(Gate::Type::MUX, {e.net, t.net, select}, merged.net));
+            }
+            values[bit] = merged;
+        }
+        break;
+    }
+    case Statement::Kind::CASE:
+        executeCase(statement, values, circuit);
+        break;
+    }
+}
 
-    if (lhs.empty() || rhs.empty()) return;
+const VerilogParser::BitValue& VerilogParser::valueOf(const BitValues& values, const std::string& bit,
+                                                     BitValue& hold) {
+    auto value = values.find(bit);
+    if (value != values.end()) return value->second;
+    hold = {holdNet(bit), true};
+    return hold;
+}
 
-    auto lhsRangePos = lhs.find('[');
-    auto rhsRangePos = rhs.find('[');
-    
-    bool lhsIsSimpleVector = (lhsRangePos != std::string::npos) && 
-                            (lhs.find_first_of(" \t()&|^~?:", lhsRangePos) == std::string::npos);
-    bool rhsIsSimpleVector = (rhsRangePos != std::string::npos) && 
-                            (rhs.find_first_of(" \t()&|^~?:", rhsRangePos) == std::string::npos);
+VerilogParser::BitValue VerilogParser::muxTree(const std::vector<BitValue>& leaves, size_t lo, size_t size,
+                                               const std::vector<std::string>& select, LogicCircuit& circuit) {
+    bool uniform = true, mayHold = false;
+    for (size_t x = lo; x < lo + size; x++) {
+        uniform = uniform && leaves[x].net == leaves[lo].net;
+        mayHold = mayHold || leaves[x].mayHold;
+    }
+    if (uniform) return {leaves[lo].net, mayHold};
+    size_t half = size / 2, bit = 0;
+    while ((size_t(2) << bit) < size) bit++;
+    BitValue low = muxTree(leaves, lo, half, select, circuit);
+    BitValue high = muxTree(leaves, lo + half, half, select, circuit);
+    std::string out = circuit.newTemp();
+    circuit.addGate(Gate(Gate::Type::MUX, {low.net, high.net, select[bit]}, out));
+    return {out, mayHold};
+}
 
-    if (lhsIsSimpleVector && rhsIsSimpleVector) {
-        int lhsMsb, lhsLsb, rhsMsb, rhsLsb;
-        parseRange(lhs, lhsMsb, lhsLsb);
-        parseRange(rhs, rhsMsb, rhsLsb);
+void VerilogParser::executeCase(const Statement& statement, BitValues& values, LogicCircuit& circuit) {
+    std::vector<std::string> select = operandBits(substituteValues(statement.expr, values, circuit), circuit);
+    size_t width = select.size();
 
-        if ((lhsMsb - lhsLsb) != (rhsMsb - rhsLsb)) {
-            throw std::runtime_error("Vector width mismatch in assignment");
+    // Every item runs from the values before the case. A constant label is a pattern
+    // over the select bits; a label no select value matches is dropped, and one that
+    // matches every value ends the list like a default.
+    struct Pattern {
+        uint64_t value = 0, care = 0;
+        std::string operand;  // non-constant label, compared with ==
+    };
+    struct Item {
+        std::vector<Pattern> patterns;
+        BitValues outcome;
+    };
+    std::vector<Item> items;
+    BitValues fallback = values;  // no item matches
+    bool constant = true, catchAll = false;
+    size_t defaultItem = statement.body.size();
+    for (size_t i = 0; i < statement.body.size() && !catchAll; i++) {
+        if (statement.labels[i].empty()) {
+            defaultItem = i;
+            continue;
+        }
+        Item item;
+        for (const std::string& label : statement.labels[i]) {
+            Pattern pattern;
+            if (width <= 64 && parseCaseLabel(label, statement.wildcards, width, pattern.value, pattern.care)) {
+                if (pattern.value & ~pattern.care) continue;
+                if (pattern.care == 0) catchAll = true;
+            } else {
+                pattern.operand = substituteValues(label, values, circuit);
+                constant = false;
+            }
+            item.patterns.push_back(pattern);
+        }
+        if (catchAll) {
+            executeStatement(statement.body[i], fallback, circuit);
+        } else if (!item.patterns.empty()) {
+            item.outcome = values;
+            executeStatement(statement.body[i], item.outcome, circuit);
+            items.push_back(std::move(item));
         }
+    }
+    if (!catchAll && defaultItem < statement.body.size()) executeStatement(statement.body[defaultItem], fallback, circuit);
 
-        int width = lhsMsb - lhsLsb + 1;
-        for (int i = 0; i < width; ++i) {
-            std::string lhsBit = lhs.substr(0, lhsRangePos) + "[" + std::to_string(lhsMsb - i) + "]";
-            std::string rhsBit = rhs.substr(0, rhsRangePos) + "[" + std::to_string(rhsMsb - i) + "]";
-            int tempCounter = 0;
-            parseExpression(rhsBit, lhsBit, circuit, tempCounter);
+    std::vector<std::string> bits;
+    for (const auto& entry : fallback) bits.push_back(entry.first);
+    for (const Item& item : items) {
+        for (const auto& entry : item.outcome) {
+            if (!fallback.count(entry.first)) bits.push_back(entry.first);
         }
     }
-    else if (isVectorBase(lhs, circuit)) {
-        std::vector<std::string> lhsBits = getVectorBits(lhs, circuit);
-        
-        for (const std::string& lhsBit : lhsBits) {
-            std::string rhsBit = rhs;
-            
-            std::vector<std::string> vectorBases;
-            for (const auto& in : circuit.inputs) {
-                size_t bracketPos = in.find('[');
-                if (bracketPos != std::string::npos) {
-                    std::string base = in.substr(0, bracketPos);
-                    if (std::find(vectorBases.begin(), vectorBases.end(), base) == vectorBases.end()) {
-                        vectorBases.push_back(base);
-                    }
+    std::sort(bits.begin(), bits.end());
+    bits.erase(std::unique(bits.begin(), bits.end()), bits.end());
+    auto outcome = [&](size_t i) -> const BitValues& { return i < items.size() ? items[i].outcome : fallback; };
+
+    // Dense constant cases become a balanced MUX tree over the select bits, log2 levels
+    // deep, with one leaf per select value
+    const size_t kMaxTreeSelect = 10;
+    if (constant && width <= kMaxTreeSelect) {
+        std::vector<size_t> leaf(size_t(1) << width, items.size());
+        for (size_t x = 0; x < leaf.size(); x++) {
+            for (size_t i = 0; i < items.size() && leaf[x] == items.size(); i++) {
+                for (const Pattern& pattern : items[i].patterns) {
+                    if (((x ^ pattern.value) & pattern.care) == 0) leaf[x] = i;
                 }
             }
-            
-            std::string tempRhs = rhsBit;
-            for (const std::string& base : vectorBases) {
-                if (isVectorBase(base, circuit)) {
-                    std::vector<std::string> baseBits = getVectorBits(base, circuit);
-                    size_t lhsIdx = 0;
-                    for (size_t i = 0; i < lhsBits.size(); i++) {
-                        if (lhsBits[i] == lhsBit) {
-                            lhsIdx = i;
-                            break;
-                        }
-                    }
-                    if (lhsIdx < baseBits.size()) {
-                        tempRhs = rewriteExpressionForBit(tempRhs, base, baseBits[lhsIdx], circuit);
-                    }
-                }
+        }
+        // A tree bit costs at most one MUX per disagreeing subtree, the decoder below
+        // about one AND per item plus an OR
+        if (muxCount(leaf, 0, leaf.size()) <= items.size() + 1) {
+            std::vector<BitValue> leaves(leaf.size()), holds(leaf.size());
+            for (const std::string& bit : bits) {
+                for (size_t x = 0; x < leaf.size(); x++) leaves[x] = valueOf(outcome(leaf[x]), bit, holds[x]);
+                values[bit] = muxTree(leaves, 0, leaves.size(), select, circuit);
             }
-            rhsBit = tempRhs;
-            
-            int tempCounter = 0;
-            parseExpression(rhsBit, lhsBit, circuit, tempCounter);
+            return;
         }
-    } else {
-        int tempCounter = 0;
-        parseExpression(rhs, lhs, circuit, tempCounter);
     }
-}
 
-void VerilogParser::parseRange(const std::string& s, int& msb, int& lsb) {
-    size_t lb = s.find('['), rb = s.find(']');
-    std::string r = s.substr(lb+1, rb-lb-1);
-    size_t colonPos = r.find(':');
-    msb = std::stoi(r.substr(0, colonPos));
-    lsb = std::stoi(r.substr(colonPos+1));
-}
+    // Otherwise a shared one-hot decoder: item i is hit when it matches and no earlier
+    // overlapping item does. Distinct constant labels never overlap, so a parallel case
+    // needs no priority logic. Each bit is then an n-ary OR over its distinct values,
+    // each ANDed with the OR of the hits that select it.
+    auto gate = [&](Gate::Type type, const std::vector<std::string>& inputs) {
+        if (inputs.size() == 1 && type != Gate::Type::NOT && type != Gate::Type::NOR) return inputs[0];
+        std::string out = circuit.newTemp();
+        circuit.addGate(Gate(type, inputs, out));
+        return out;
+    };
+    std::vector<std::string> inverted(width), matches(items.size()), hits(items.size());
+    std::string none;
+    auto match = [&](size_t i) {
+        if (!matches[i].empty()) return matches[i];
+        std::vector<std::string> terms;
+        for (const Pattern& pattern : items[i].patterns) {
+            if (!pattern.operand.empty()) {
+                std::string equal = circuit.newTemp();
+                ArithmeticBuilder::compare(circuit, select, operandBits(pattern.operand, circuit),
+                                           ArithmeticBuilder::Comparison::EQ, equal, directComparators);
+                terms.push_back(equal);
+                continue;
+            }
+            std::vector<std::string> literals;
+            for (size_t j = 0; j < width; j++) {
+                if (!(pattern.care >> j & 1)) continue;
+                if (pattern.value >> j & 1) {
+                    literals.push_back(select[j]);
+                } else {
+                    if (inverted[j].empty()) inverted[j] = gate(Gate::Type::NOT, {select[j]});
+                    literals.push_back(inverted[j]);
+                }
+            }
+            terms.push_back(gate(Gate::Type::AND, literals));
+        }
+        return matches[i] = gate(Gate::Type::OR, terms);
+    };
+    auto overlap = [&](size_t i, size_t j) {
+        for (const Pattern& p : items[i].patterns) {
+            for (const Pattern& q : items[j].patterns) {
+                if (!p.operand.empty() || !q.operand.empty() || ((p.value ^ q.value) & p.care & q.care) == 0) return true;
+            }
+        }
+        return false;
+    };
+    auto hit = [&](size_t i) {
+        if (!hits[i].empty()) return hits[i];
+        std::vector<std::string> terms = {match(i)};
+        for (size_t j = 0; j < i; j++) {
+            if (overlap(i, j)) terms.push_back(gate(Gate::Type::NOT, {match(j)}));
+        }
+        return hits[i] = gate(Gate::Type::AND, terms);
+    };
+    auto selected = [&](size_t i) {
+        if (i < items.size()) return hit(i);
+        if (none.empty()) {
+            std::vector<std::string> all;
+            for (size_t j = 0; j < items.size(); j++) all.push_back(match(j));
+            none = gate(Gate::Type::NOR, all);
+        }
+        return none;
+    };
 
-std::string VerilogParser::extractBaseName(const std::string& signal) {
-    size_t pos = signal.find('[');
-    if (pos != std::string::npos) {
-        return signal.substr(0, pos);
+    for (const std::string& bit : bits) {
+        // Distinct values of the bit, each with the items (items.size() = no match) giving it
+        std::vector<std::pair<BitValue, std::vector<size_t>>> groups;
+        for (size_t i = 0; i <= items.size(); i++) {
+            BitValue hold;
+            const BitValue& value = valueOf(outcome(i), bit, hold);
+            auto group = std::find_if(groups.begin(), groups.end(),
+                                      [&](const std::pair<BitValue, std::vector<size_t>>& g) { return g.first.net == value.net; });
+            if (group == groups.end()) {
+                groups.push_back({value, {i}});
+            } else {
+                group->first.mayHold = group->first.mayHold || value.mayHold;
+                group->second.push_back(i);
+            }
+        }
+        bool mayHold = std::any_of(groups.begin(), groups.end(),
+                                   [](const std::pair<BitValue, std::vector<size_t>>& g) { return g.first.mayHold; });
+        auto select = [&](const std::vector<size_t>& group) {
+            std::vector<std::string> terms;
+            for (size_t i : group) terms.push_back(selected(i));
+            return gate(Gate::Type::OR, terms);
+        };
+        if (groups.size() == 1) {
+            values[bit] = {groups[0].first.net, mayHold};
+        } else if (groups.size() == 2) {
+            // The group without the no-match case is a plain OR of hits
+            const auto& other = groups[0].second.back() == items.size() ? groups[1] : groups[0];
+            const auto& rest = &other == &groups[0] ? groups[1] : groups[0];
+            std::string out = circuit.newTemp();
+            circuit.addGate(Gate(Gate::Type::MUX, {rest.first.net, other.first.net, select(other.second)}, out));
+            values[bit] = {out, mayHold};
+        } else {
+            std::vector<std::string> terms;
+            for (const auto& group : groups) terms.push_back(gate(Gate::Type::AND, {select(group.second), group.first.net}));
+            values[bit] = {gate(Gate::Type::OR, terms), mayHold};
+        }
     }
-    return signal;
 }
 
-bool VerilogParser::isVectorBase(const std::string& name, const LogicCircuit& circuit) {
-    for (const auto& signal : circuit.inputs) {
-        if (signal.length() > name.length() + 2 && 
-            signal.substr(0, name.length()) == name && 
-            signal[name.length()] == '[') {
-            return true;
+bool VerilogParser::parseCaseLabel(const std::string& label, char wildcards, size_t width,
+                                   uint64_t& value, uint64_t& care) {
+    std::string text = label;
+    text.erase(std::remove_if(text.begin(), text.end(), [](unsigned char c) { return isspace(c) || c == '_'; }),
+               text.end());
+    uint64_t mask = width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    size_t tick = text.find('\'');
+    size_t pos = tick + 1;
+    if (tick != std::string::npos && pos < text.size() && (text[pos] == 's' || text[pos] == 'S')) pos++;
+    int digitBits = 0;
+    if (tick != std::string::npos && pos < text.size()) {
+        switch (tolower(static_cast<unsigned char>(text[pos]))) {
+            case 'b': digitBits = 1; break;
+            case 'o': digitBits = 3; break;
+            case 'h': digitBits = 4; break;
         }
     }
-    for (const auto& signal : circuit.outputs) {
-        if (signal.length() > name.length() + 2 && 
-            signal.substr(0, name.length()) == name && 
-            signal[name.length()] == '[') {
-            return true;
+    if (digitBits == 0) {
+        if (!parseIntegerLiteral(text, value)) return false;
+        care = mask;
+        return true;
+    }
+
+    value = care = 0;
+    uint64_t digitMask = (uint64_t(1) << digitBits) - 1;
+    for (size_t i = pos + 1; i < text.size(); i++) {
+        char c = static_cast<char>(tolower(static_cast<unsigned char>(text[i])));
+        bool wild = c == '?' || c == 'z' || c == 'x';
+        if (wild && !(c == '?' || c == 'z' ? wildcards != 0 : wildcards == 'x')) {
+            throw std::runtime_error("Case label " + label + " can never match a 2-valued select (use casez / casex)");
         }
+        uint64_t digit = 0;
+        if (!wild) {
+            if (!isxdigit(static_cast<unsigned char>(c))) return false;
+            digit = isdigit(static_cast<unsigned char>(c)) ? c - '0' : c - 'a' + 10;
+            if (digit > digitMask) return false;
+        }
+        value = (value << digitBits) | digit;
+        care = (care << digitBits) | (wild ? 0 : digitMask);
     }
-    return false;
+    if (pos + 1 >= text.size()) return false;
+    // Bits above the select width must be 0 to match: keep them in value, not in care
+    care &= mask;
+    value &= care | ~mask;
+    return true;
 }
 
-std::vector<std::string> VerilogParser::getVectorBits(const std::string& baseName, const LogicCircuit& circuit) {
-    std::vector<std::string> bits;
-    
-    for (const auto& signal : circuit.outputs) {
-        if (signal.length() > baseName.length() + 2 && 
-            signal.substr(0, baseName.length()) == baseName && 
-            signal[baseName.length()] == '[') {
-            bits.push_back(signal);
+std::string VerilogParser::substituteValues(const std::string& expr, const BitValues& values, LogicCircuit& circuit) {
+    if (values.empty()) return expr;
+    // A whole vector or part-select with assigned bits reads an internal copy of its value
+    auto view = [&](const std::vector<std::string>& bits) {
+        std::string word = newVector(bits.size(), circuit);
+        const std::vector<std::string>& copy = circuit.internalVectors[word];
+        for (size_t k = 0; k < bits.size(); k++) {
+            auto value = values.find(bits[k]);
+            circuit.addGate(Gate(Gate::Type::BUF, {value != values.end() ? value->second.net : bits[k]}, copy[k]));
         }
-    }
-    
-    if (bits.empty()) {
-        for (const auto& signal : circuit.inputs) {
-            if (signal.length() > baseName.length() + 2 && 
-                signal.substr(0, baseName.length()) == baseName && 
-                signal[baseName.length()] == '[') {
-                bits.push_back(signal);
+        return word;
+    };
+    auto assigned = [&](const std::vector<std::string>& bits) {
+        return std::any_of(bits.begin(), bits.end(), [&](const std::string& bit) { return values.count(bit) > 0; });
+    };
+
+    std::string result;
+    for (size_t i = 0; i < expr.size();) {
+        if (!isIdentChar(expr[i])) {
+            result += expr[i++];
+            continue;
+        }
+        std::string word = wordAt(expr, i);
+        size_t end = i + word.size();
+        i = end;
+        // Numbers and the digits of sized literals
+        if (isdigit(static_cast<unsigned char>(word[0])) || (end > word.size() && expr[end - word.size() - 1] == '\'')) {
+            result += word;
+            continue;
+        }
+        size_t next = end;
+        skipSpace(expr, next);
+        if (next < expr.size() && expr[next] == '[') {
+            size_t close = expr.find(']', next);
+            std::string index = close == std::string::npos ? "" : trim(expr.substr(next + 1, close - next - 1));
+            std::vector<std::string> bits;
+            size_t colon = index.find(':');
+            bool numeric = !index.empty() && std::all_of(index.begin(), index.end(), [](unsigned char c) {
+                return isdigit(c) || isspace(c) || c == ':';
+            });
+            if (numeric && colon == std::string::npos) {
+                bits.push_back(word + "[" + index + "]");
+            } else if (numeric) {
+                int msb = std::stoi(index.substr(0, colon)), lsb = std::stoi(index.substr(colon + 1));
+                for (int b = msb; msb >= lsb ? b >= lsb : b <= lsb; b += msb >= lsb ? -1 : 1) {
+                    bits.push_back(word + "[" + std::to_string(b) + "]");
+                }
+            }
+            if (assigned(bits)) {
+                result += bits.size() == 1 ? values.at(bits[0]).net : view(bits);
+                i = close + 1;
+            } else {
+                result += word;
             }
+            continue;
+        }
+        auto value = values.find(word);
+        if (value != values.end()) {
+            result += value->second.net;
+        } else if (isVectorBase(word, circuit) && assigned(getVectorBits(word, circuit))) {
+            result += view(getVectorBits(word, circuit));
+        } else {
+            result += word;
         }
     }
-    
-    std::sort(bits.begin(), bits.end(), [](const std::string& a, const std::string& b) {
-        size_t a_start = a.find('[') + 1;
-        size_t a_end = a.find(']', a_start);
-        size_t b_start = b.find('[') + 1;
-        size_t b_end = b.find(']', b_start);
-        
-        if (a_start != std::string::npos && a_end != std::string::npos && 
-            b_start != std::string::npos && b_end != std::string::npos) {
-            int a_idx = std::stoi(a.substr(a_start, a_end - a_start));
-            int b_idx = std::stoi(b.substr(b_start, b_end - b_start));
-            return a_idx > b_idx;
+    return result;
+}
+
+std::vector<std::string> VerilogParser::targetBits(const std::string& lhs, const LogicCircuit& circuit) {
+    std::string target = lhs;
+    target.erase(std::remove_if(target.begin(), target.end(), ::isspace), target.end());
+    if (target.size() > 2 && target.front() == '{' && target.back() == '}') {
+        std::vector<std::string> bits;
+        size_t start = 1;
+        int depth = 0;
+        for (size_t i = 1; i < target.size(); i++) {
+            if (target[i] == '{') depth++;
+            if (target[i] == '}' && depth-- > 0) continue;
+            if ((target[i] == ',' && depth == 0) || i + 1 == target.size()) {
+                std::vector<std::string> part = targetBits(target.substr(start, i - start), circuit);
+                bits.insert(bits.end(), part.begin(), part.end());
+                start = i + 1;
+            }
         }
-        return a < b;
-    });
-    
+        return bits;
+    }
+    size_t open = target.find('[');
+    if (open == std::string::npos) {
+        return isVectorBase(target, circuit) ? getVectorBits(target, circuit) : std::vector<std::string>{target};
+    }
+    if (target.find(':', open) == std::string::npos) return {target};
+    int msb, lsb;
+    parseRange(target, msb, lsb);
+    std::vector<std::string> bits;
+    for (int b = msb; msb >= lsb ? b >= lsb : b <= lsb; b += msb >= lsb ? -1 : 1) {
+        bits.push_back(target.substr(0, open) + "[" + std::to_string(b) + "]");
+    }
     return bits;
 }
 
-std::string VerilogParser::rewriteExpressionForBit(const std::string& expr, const std::string& baseName, 
-                                                 const std::string& bitSignal, const LogicCircuit& circuit) {
-    std::string result = expr;
-    size_t pos = 0;
+void VerilogParser::parseGenerateBlock(const std::string& block, LogicCircuit& circuit) {
+    if (verbose) std::cout << "DEBUG GENERATE: Processing generate block" << std::endl;
+    
+    if (block.find("for") != std::string::npos) {
+        parseForGenerate(block, circuit);
+    }
+}
+
+std::string VerilogParser::evaluateGenerateExpression(std::string expr, const std::string& varName, int value) {
+    // This regex finds patterns like [i], [i+1], [1+i], [7-i], [i*2], [2*i] etc.
+    std::regex pattern(R"(\[(\s*(?:\w+|\d+)\s*(?:[\+\-\*]\s*(?:\w+|\d+)\s*)*)\])");
     
-    while ((pos = result.find(baseName, pos)) != std::string::npos) {
-        bool beforeOk = (pos == 0) || !std::isalnum(static_cast<unsigned char>(result[pos-1]));
-        size_t afterPos = pos + baseName.length();
-        bool afterOk = (afterPos >= result.length()) || !std::isalnum(static_cast<unsigned char>(result[afterPos]));
+    // Use sregex_iterator for safe iteration over all matches
+    auto matches_begin = std::sregex_iterator(expr.begin(), expr.end(), pattern);
+    auto matches_end = std::sregex_iterator();
+
+    std::string result;
+    // FIX 1: Use cbegin() to get a const_iterator
+    auto last_match_end = expr.cbegin();
+
+    for (std::sregex_iterator i = matches_begin; i != matches_end; ++i) {
+        std::smatch match = *i;
+        std::string inner_expr = match[1].str();
+        
+        result.append(last_match_end, match.prefix().second);
         
-        if (beforeOk && afterOk) {
-            result.replace(pos, baseName.length(), bitSignal);
-            pos += bitSignal.length();
+        if (inner_expr.find(varName) != std::string::npos) {
+            std::string replaced_inner = std::regex_replace(inner_expr, std::regex("\\b" + varName + "\\b"), std::to_string(value));
+            
+            int finalValue = value;
+            std::smatch arith_match;
+            if (std::regex_match(replaced_inner, arith_match, std::regex(R"(\s*(\d+)\s*-\s*(\d+)\s*)"))) {
+                finalValue = std::stoi(arith_match[1]) - std::stoi(arith_match[2]);
+            } else if (std::regex_match(replaced_inner, arith_match, std::regex(R"(\s*(\d+)\s*\+\s*(\d+)\s*)"))) {
+                finalValue = std::stoi(arith_match[1]) + std::stoi(arith_match[2]);
+            } else if (std::regex_match(replaced_inner, arith_match, std::regex(R"(\s*(\d+)\s*)"))) {
+                finalValue = std::stoi(arith_match[1]);
+            }
+            
+            result += "[" + std::to_string(finalValue) + "]";
         } else {
-            pos += baseName.length();
+            result += "[" + inner_expr + "]";
         }
+        
+        last_match_end = match.suffix().first;
     }
-    
+
+    // --- THIS IS THE NEW FIX ---
+    // Use cend() to get a const_iterator for the end of the string.
+    result.append(last_match_end, expr.cend());
+
     return result;
 }
 
-int VerilogParser::getVectorWidth(const std::string& baseName, const LogicCircuit& circuit) {
-    int width = 0;
-    for (const auto& out : circuit.outputs) {
-        if (out.find(baseName + "[") == 0) {
-            width++;
+void VerilogParser::parseForGenerate(const std::string& block, LogicCircuit& circuit) {
+    // This regex is more robust:
+    // - Handles optional "genvar"
+    // - Captures the loop variable name (i)
+    // - Captures the start value
+    // - Captures the comparison operator (<, <=, >, >=)
+    // - Captures the end value
+    // - Handles both "i = i + S" and "i++" / "++i" style increments
+    std::regex forRegex(R"(for\s*\(\s*(?:genvar\s+)?(\w+)\s*=\s*(\d+)\s*;\s*\1\s*([<>]=?)\s*(\d+)\s*;\s*(?:(?:\+\+)?\s*\1(?:\s*\+\+)?|\1\s*=\s*\1\s*\+\s*(\d+))\s*\)\s*begin)");
+    std::smatch match;
+
+    if (std::regex_search(block, match, forRegex)) {
+        std::string varName = match[1].str();
+        int start = std::stoi(match[2].str());
+        std::string op = match[3].str();
+        int endCond = std::stoi(match[4].str());
+        int step = 1;
+        if (match[5].matched) { // Check if the "i = i + S" group was matched
+            step = std::stoi(match[5].str());
         }
-    }
-    if (width == 0) {
-        for (const auto& in : circuit.inputs) {
-            if (in.find(baseName + "[") == 0) {
-                width++;
+
+        if (verbose) std::cout << "DEBUG GENERATE: Unrolling loop for " << varName 
+            << " from " << start << " with condition " << op << " " << endCond << " step " << step << std::endl;
+        
+        // Robustly find the body of the generate block
+        size_t bodyStartPos = block.find("begin", match.position(0));
+        if (bodyStartPos == std::string::npos) {
+            std::cout << "WARNING: Malformed for-generate block, 'begin' not found." << std::endl;
+            return;
+        }
+        bodyStartPos += 5; // move past "begin"
+
+        size_t bodyEndPos = std::string::npos;
+        int depth = 1;
+        for (size_t i = bodyStartPos; i < block.length(); ++i) {
+            if (i + 4 < block.length() && block.substr(i, 5) == "begin") {
+                depth++;
+                i += 4;
+            } else if (i + 2 < block.length() && block.substr(i, 3) == "end") {
+                depth--;
+                if (depth == 0) {
+                    bodyEndPos = i;
+                    break;
+                }
+                i += 2;
+            }
+        }
+
+        if (bodyEndPos == std::string::npos) {
+            std::cout << "WARNING: Malformed for-generate block, matching 'end' not found." << std::endl;
+            return;
+        }
+
+        std::string body = block.substr(bodyStartPos, bodyEndPos - bodyStartPos);
+
+        for (int i = start; ; i += step) {
+            // Check the end condition based on the captured operator
+            bool conditionMet;
+            if (op == "<") conditionMet = (i < endCond);
+            else if (op == "<=") conditionMet = (i <= endCond);
+            else if (op == ">") conditionMet = (i > endCond);
+            else if (op == ">=") conditionMet = (i >= endCond);
+            else { std::cout << "WARNING: Unknown operator in generate for loop" << std::endl; break; }
+
+            if (!conditionMet) break;
+
+            if (verbose) std::cout << "DEBUG GENERATE: Iteration " << varName << " = " << i << std::endl;
+            
+            // 1. First, replace the genvar if it appears in arithmetic expressions inside brackets []
+            std::string unrolledBody = evaluateGenerateExpression(body, varName, i);
+            
+            // 2. Then, replace any remaining standalone instances of the genvar
+            unrolledBody = std::regex_replace(unrolledBody, std::regex("\\b" + varName + "\\b"), std::to_string(i));
+
+            std::istringstream iss(unrolledBody);
+            std::string line;
+            while (std::getline(iss, line)) {
+                line = trim(line);
+                if (line.empty()) continue;
+                // You can expand this to handle other statement types inside a generate block
+                if (line.find("assign") != std::string::npos) {
+                    parseAssignment(line, circuit);
+                }
             }
         }
+    } else {
+        std::cout << "WARNING: Unsupported for-generate syntax. Skipping." << std::endl;
+        std::cout << "Block was: \"" << block << "\"" << std::endl;
     }
-    return width;
 }
 
-LogicCircuit VerilogParser::parse(const std::string& filename) {
+LogicCircuit VerilogParser::parse(const std::string& filename, const std::vector<std::string>& observed) {
     std::ifstream file(filename);
     if (!file.is_open()) {
         throw std::runtime_error("Cannot open file");
     }
 
+    // Tokens and other parse scratch go to one arena, released when parsing is done
+    PhaseArena arena(PhaseArena::PARSE);
+    // Vector expressions collect in one word graph, bit-blasted once the module is read
+    WordGraph graph;
+    struct RestoreState {
+        std::pmr::memory_resource* resource;
+        WordGraph* graph;
+        ~RestoreState() {
+            parseResource = resource;
+            wordGraph = graph;
+        }
+    } restore{parseResource, wordGraph};
+    parseResource = arena.resource();
+    wordGraph = &graph;
+
     LogicCircuit circuit;
     std::string line;
     while (std::getline(file, line)) {
@@ -733,18 +3274,66 @@ LogicCircuit VerilogParser::parse(const std::string& filename) {
         if (commentPos != std::string::npos) {
             line = line.substr(0, commentPos);
         }
-        if (line.find("module") != std::string::npos) continue;
-        if (line.find("endmodule") != std::string::npos) continue;
+        std::string trimmedLine = trim(line);
+        if (trimmedLine.empty()) continue;
 
-        if (line.find("input") != std::string::npos) {
+        if (trimmedLine.rfind("module", 0) == 0) {
+            // module <name> (...); only the name is taken from the header
+            size_t start = trimmedLine.find_first_not_of(" \t", 6);
+            if (start != std::string::npos) {
+                circuit.name = trimmedLine.substr(start, trimmedLine.find_first_of(" \t(;#", start) - start);
+            }
+            continue;
+        }
+        if (trimmedLine.rfind("endmodule", 0) == 0) continue;
+        
+        // *** START OF FIX ***
+        // Prioritize block-level statements like generate and always.
+        if (trimmedLine.rfind("generate", 0) == 0) {
+            std::string block = line;
+            std::string currentLine;
+            int depth = 1;
+            // Read the entire block until the matching endgenerate
+            while (std::getline(file, currentLine)) {
+                block += "\n" + currentLine;
+                if (currentLine.find("generate") != std::string::npos) depth++;
+                if (currentLine.find("endgenerate") != std::string::npos) depth--;
+                if (depth == 0) break;
+            }
+            parseGenerateBlock(block, circuit);
+        }
+        else if (trimmedLine.rfind("always", 0) == 0) {
+            std::string block = readVerilogBlock(file, line);
+            parseAlwaysBlock(block, circuit);
+        }
+        // Only parse these if they are not inside a block being handled above.
+        else if (trimmedLine.rfind("input", 0) == 0) {
             parseIO(line, circuit.inputs);
         }
-        else if (line.find("output") != std::string::npos) {
+        else if (trimmedLine.rfind("output", 0) == 0) {
             parseIO(line, circuit.outputs);
         }
-        else if (line.find("assign") != std::string::npos) {
+        else if (trimmedLine.rfind("wire", 0) == 0 || trimmedLine.rfind("logic", 0) == 0) {
+            parseWireDeclaration(line, circuit);
+        }
+        else if (trimmedLine.rfind("reg", 0) == 0) {
+            parseIO(line, circuit.registers);
+        }
+        else if (trimmedLine.rfind("assign", 0) == 0) {
             parseAssignment(line, circuit);
         }
+        // *** END OF FIX ***
+    }
+
+    WordGraph::Lowering lowering{adderArchitecture, multiplierArchitecture, canonicalPartialProducts,
+                                 directComparators};
+    // The next state of every register is observed too: later frames read it
+    std::vector<std::string> roots = observed;
+    if (!roots.empty()) {
+        for (const auto& latch : circuit.latches) roots.push_back(latch.second);
     }
+    size_t blasted = graph.blast(circuit, roots, lowering);
+    if (verbose) std::cout << "DEBUG WORD: " << graph.size() << " word nodes, " << blasted << " of "
+                           << graph.definedBits() << " word-defined bits blasted" << std::endl;
     return circuit;
 }
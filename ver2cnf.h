@@ -4,6 +4,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <sstream>
@@ -11,11 +12,15 @@
 #include <algorithm>
 #include <cctype>
 #include <cassert>
+#include <memory>
+#include "arena.h"
 
 // ---------------- Gate ----------------
 class Gate {
 public:
-    enum class Type { AND, OR, NOT, XOR, XNOR, NAND, NOR, BUF, MUX };
+    // MUX inputs are {a, b, sel} (sel ? b : a); MAJ is the 3-input majority (full-adder carry);
+    // EQ inputs are bit pairs {a0, b0, a1, b1, ...}, true when every pair agrees
+    enum class Type { AND, OR, NOT, XOR, XNOR, NAND, NOR, BUF, MUX, MAJ, EQ };
     Type type;
     std::vector<std::string> inputs;
     std::string output;
@@ -23,6 +28,24 @@ public:
     Gate(Type t, std::vector<std::string> in, std::string out) : type(t), inputs(in), output(out) {}
 };
 
+// ---------------- Levelization ----------------
+// Topological view of a LogicCircuit; gates are identified by their index in `gates`.
+// Level 1 gates read only undriven signals, every other gate sits one level above its
+// deepest driver.
+struct Levelization {
+    std::vector<size_t> order;       // acyclic gates, each after the drivers of its inputs
+    std::vector<int> level;          // per gate, -1 for gates on or behind a loop
+    std::vector<size_t> fanout;      // per gate, number of gate inputs reading its output
+    std::vector<std::string> cycle;  // signals around one combinational loop, empty if none
+    int depth = 0;
+};
+
+// Transitive fanin of some signals, see LogicCircuit::cone
+struct Cone {
+    std::vector<size_t> gates;        // by level, so each gate comes after the drivers of its inputs
+    std::vector<std::string> leaves;  // undriven signals read by the cone (or roots), sorted
+};
+
 // ---------------- LogicCircuit ----------------
 class LogicCircuit {
 public:
@@ -31,50 +54,388 @@ public:
     std::unordered_set<std::string> inputs;
     std::unordered_set<std::string> outputs;
     std::unordered_set<std::string> wires;
+    std::unordered_set<std::string> registers;
+    // Registers of clocked always blocks: current-state bit -> signal holding its next
+    // state. Current-state bits are inputs, so the gates are one frame of the transition
+    // relation (see Unroller).
+    std::map<std::string, std::string> latches;
+    // Constant nets: gate inputs with these names are tied to 0 / 1
+    static const std::string kConst0;
+    static const std::string kConst1;
+    // Names merged into an existing gate by addGate (name -> signal it duplicates)
+    std::unordered_map<std::string, std::string> aliases;
+    // Parsed expression text (whitespace removed) -> net computing it, shared by every
+    // assignment of the module
+    std::unordered_map<std::string, std::string> expressions;
+    // Word-wide intermediate values the parser creates (base "$<n>" -> bits, MSB first),
+    // and declared vector wires. They are vectors to every parser lookup but never ports.
+    std::unordered_map<std::string, std::vector<std::string>> internalVectors;
 
+    // Hash-consing: a gate with the same type and (canonical, for commutative types sorted)
+    // fanins as an existing one is not rebuilt; its output becomes an alias driven by a BUF
+    // from the existing signal. Re-adding an identical driver is a no-op, a different
+    // driver for an already driven signal throws. Inputs that are aliases of a constant
+    // are replaced by it and the gate is folded with simplify first.
     void addGate(const Gate& gate);
+    // Constant folding: the cheapest gate equivalent to `gate` given its constant (kConst0 /
+    // kConst1) and repeated inputs. AND with 0 is a BUF of 0, XOR with 1 a NOT, a MUX with
+    // a constant select a BUF of the selected input, x & x is x, x ^ x is 0, and so on.
+    static Gate simplify(const Gate& gate);
+    // Fresh internal signal "$<n>", numbered per circuit. No Verilog identifier starts
+    // with '$', so temporaries cannot clash with user names, and the name stays short
+    // whatever the expression nesting depth.
+    std::string newTemp();
+    // Follows aliases to the signal that actually computes `signal`
+    const std::string& canonical(const std::string& signal) const;
+    // Sinks (gate outputs no gate reads) plus declared outputs, sorted. Temporaries are
+    // never outputs: a "$" sink is logic a later statement superseded.
     std::vector<std::string> getOutputs() const;
     std::vector<std::string> getInputs() const;
+
+    // Kept up to date by addGate, O(1) per gate input
+    const std::unordered_set<std::string>& getSinks() const;     // driven, read by no gate
+    const std::unordered_set<std::string>& getUndriven() const;  // read, driven by no gate
+    size_t getFanout(const std::string& signal) const;           // gate inputs reading `signal`
+    bool isDriven(const std::string& signal) const;              // output of some gate
+
+    // Topological order, levels, fanout counts and loop diagnostics in O(V + E). The
+    // result is cached: addGate extends it in place while the new gate feeds nothing
+    // yet and drops it otherwise. Edits made to `gates` directly are not tracked, and
+    // the first call after a change must not race with other readers.
+    const Levelization& levelize() const;
+    // Gates in the transitive fanin of `roots` in levelize() order, for consumers that
+    // only evaluate some outputs. With `done` (one flag per gate), flagged gates and
+    // their fanin are skipped and the collected gates get flagged, so successive calls
+    // visit each gate once. Throws when a combinational loop feeds the cone.
+    Cone cone(const std::vector<std::string>& roots, std::vector<char>* done = nullptr) const;
+    // Index in `gates` of the gate driving `signal`, gates.size() when it is undriven
+    size_t driverOf(const std::string& signal) const;
+
+private:
+    struct GateKey {
+        Gate::Type type;
+        std::vector<int> fanin;
+        bool operator==(const GateKey& other) const { return type == other.type && fanin == other.fanin; }
+    };
+    struct GateKeyHash {
+        size_t operator()(const GateKey& key) const;
+    };
+
+    std::unordered_map<std::string, int> signalIds;
+    std::unordered_map<GateKey, std::string, GateKeyHash> gateTable;
+    std::unordered_map<std::string, GateKey> driverKey;
+    std::unordered_map<std::string, size_t> driverIndex;
+    std::unordered_map<std::string, size_t> readCount;
+    std::unordered_set<std::string> sinks;
+    std::unordered_set<std::string> undriven;
+    mutable Levelization levels;
+    mutable bool levelsValid = false;
+    size_t tempCount = 0;
+
+    int signalId(const std::string& signal);
+    void updateLevels(size_t gateIndex, bool outputWasRead);
 };
 
 // ---------------- CNFConverter ----------------
+// Literal lists are scratch of one encoding and live in its CNF-phase arena
+using Literals = std::pmr::vector<int>;
+
+// Clauses stored back to back in one array: a clause costs no allocation of its own, and
+// the list is an ordinary value that owns its storage
+class ClauseList {
+public:
+    // Literals of one clause
+    class Clause {
+    public:
+        Clause(const int* first, const int* last) : first(first), last(last) {}
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+
+    private:
+        const int* first;
+        const int* last;
+    };
+
+    class Iterator {
+    public:
+        Iterator(const ClauseList& list, size_t index) : list(&list), index(index) {}
+        Clause operator*() const { return (*list)[index]; }
+        Iterator& operator++() {
+            index++;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+    private:
+        const ClauseList* list;
+        size_t index;
+    };
+
+    void add(std::initializer_list<int> lits) {
+        literals.insert(literals.end(), lits);
+        ends.push_back(literals.size());
+    }
+    // A clause built a literal at a time: addLiteral, then endClause
+    void addLiteral(int lit) { literals.push_back(lit); }
+    void endClause() { ends.push_back(literals.size()); }
+
+    size_t size() const { return ends.size(); }
+    Clause operator[](size_t i) const {
+        return Clause(literals.data() + (i ? ends[i - 1] : 0), literals.data() + ends[i]);
+    }
+    Iterator begin() const { return Iterator(*this, 0); }
+    Iterator end() const { return Iterator(*this, size()); }
+
+private:
+    std::vector<int> literals;
+    std::vector<size_t> ends;  // end of each clause in literals
+};
+
 class CNFConverter {
 private:
     int variableCounter;
+    int constantVariable;
+    size_t xorCut;
     std::unordered_map<std::string, int> variableMap;
+    // Arena of the running encode, for Literals
+    std::pmr::memory_resource* scratch = std::pmr::get_default_resource();
 
-    int getVariable(const std::string& name);
+    int newVariable();
     void resetVariables();
-    std::vector<std::vector<int>> gateToCNF(const Gate& gate);
+    // Literal fixed to `value` (one shared variable forced true by a unit clause)
+    int constant(bool value, ClauseList& clauses);
+    bool isConstant(int lit, bool& value) const;
+    // Each encoder folds constants and trivial cases first and returns the output literal
+    int encodeAnd(const Literals& lits, ClauseList& clauses);
+    int encodeXor(const Literals& lits, ClauseList& clauses);
+    int encodeMux(int a, int b, int sel, ClauseList& clauses);
+    int encodeMaj(int a, int b, int c, ClauseList& clauses);
+    int encodeEq(const Literals& pairs, ClauseList& clauses);
+    int gateToCNF(const Gate& gate, const Literals& in, ClauseList& clauses);
+    ClauseList encode(const LogicCircuit& circuit, const std::vector<std::string>& roots);
 
 public:
     CNFConverter();
-    std::vector<std::vector<int>> circuitToCNF(const LogicCircuit& circuit);
+    // XORs of up to `cut` inputs and EQs of up to `cut` pairs are encoded directly (2^cut
+    // clauses, no intermediate variables); wider ones are split into chunks of that size
+    void setXorCut(size_t cut);
+    // Tseitin encoding with netlist simplification on the fly: BUFs and NOTs cost no
+    // variable (an inverter becomes a complemented literal in its consumers), double
+    // inversions cancel and constants propagate through the gates they feed.
+    ClauseList circuitToCNF(const LogicCircuit& circuit);
+    // Cone-of-influence encoding: only the transitive fanin of `roots` is encoded and
+    // numbered (compactly, from 1); the variable map holds just those signals
+    ClauseList circuitToCNF(const LogicCircuit& circuit, const std::vector<std::string>& roots);
+    // Literal of every wire: a negative entry is the complement of that variable
     std::unordered_map<std::string, int> getVariableMap() const;
     int getNumVariables() const;
 };
 
+// ---------------- StructuralHasher ----------------
+// AIG-style structural hashing. Gates are rewritten into AND/XOR/MUX nodes over
+// literals (node * 2 + complement bit): commutative operands are sorted, inversions
+// are pushed onto edges and trivial cases are folded, so structurally identical
+// logic collapses onto a single node no matter which circuit it came from.
+class StructuralHasher {
+public:
+    // Rebuilds the fanin cones of `roots` from the hashed graph. Every signal in those
+    // cones that folds to a constant is reported in `constants`; constant roots get
+    // no driver in the result.
+    static LogicCircuit hash(const LogicCircuit& circuit, const std::vector<std::string>& roots,
+                             std::unordered_map<std::string, bool>& constants);
+};
+
+// ---------------- GateFusion ----------------
+// Merges single-fanout chains of the same associative gate into one n-ary gate before
+// encoding: AND into AND/NAND, OR into OR/NOR, XOR into XOR/XNOR (up to `xorCut`
+// inputs, since the direct XOR encoding grows as 2^n). Declared outputs and `keep`
+// signals are never absorbed, so they stay in the variable map.
+class GateFusion {
+public:
+    static LogicCircuit fuse(const LogicCircuit& circuit, size_t xorCut = 3,
+                             const std::vector<std::string>& keep = {});
+};
+
+// ---------------- AdderArchitecture ----------------
+// How `+` and `-` on vectors are turned into gates (see ArithmeticBuilder)
+enum class AdderArchitecture {
+    RIPPLE,           // chain of full adders, n - 1 carry levels
+    CARRY_LOOKAHEAD,  // 4-bit lookahead blocks, block carries ripple
+    KOGGE_STONE,      // parallel prefix, log2(n) levels, n - 2^k cells per level
+    BRENT_KUNG,       // parallel prefix, 2 log2(n) levels, about 2n cells
+    SKLANSKY          // parallel prefix, log2(n) levels, n/2 cells per level, high fanout
+};
+
+// How vector `*` reduces its partial products to two rows before the final adder
+enum class MultiplierArchitecture {
+    WALLACE,  // every stage adds up as many bits as possible (full and half adders)
+    DADDA     // every stage adds only what the next height target requires, fewer adders
+};
+
 // ---------------- VerilogParser ----------------
+class WordGraph;
+
 class VerilogParser {
 private:
-    static std::string generateTempName(const std::string& base, int& counter);
-    static std::vector<std::string> tokenize(const std::string& expr);
+    // Expression tokens live in the PARSE arena of the running parse
+    using Token = std::pmr::string;
+    using TokenList = std::pmr::vector<Token>;
+    // Word-expression tokens, likewise (short tokens fit in the string itself)
+    using WordTokens = std::pmr::vector<std::string>;
+
+    static std::string trim(const std::string& s);
+    static TokenList tokenize(const std::string& expr);
     static std::string parseExpression(const std::string& expr, const std::string& target, 
-                                     LogicCircuit& circuit, int& tempCounter);
+                                     LogicCircuit& circuit);
+    static std::string buildExpression(const std::string& cleaned, const std::string& target,
+                                     LogicCircuit& circuit);
     static void parseIO(const std::string& line, std::unordered_set<std::string>& container);
+    // wire / logic declarations: vectors become internal vectors, an initializer an assign
+    static void parseWireDeclaration(const std::string& line, LogicCircuit& circuit);
     static void parseAssignment(const std::string& line, LogicCircuit& circuit);
+    static void driveSignal(const std::string& rhs, const std::string& lhs, LogicCircuit& circuit);
     static void parseRange(const std::string& s, int& msb, int& lsb);
+
+    // Arithmetic on vectors
+    static std::string generateAdder(const std::string& leftOp, const std::string& rightOp,
+                                     const std::string& target, LogicCircuit& circuit);
+    static std::string generateSubtractor(const std::string& leftOp, const std::string& rightOp,
+                                          const std::string& target, LogicCircuit& circuit);
+    static std::string generateMultiplier(const std::string& leftOp, const std::string& rightOp,
+                                          const std::string& target, LogicCircuit& circuit);
+    static std::string generateShifter(const std::string& op, const std::string& leftOp,
+                                       const std::string& rightOp, const std::string& target,
+                                       LogicCircuit& circuit);
+    static std::string generateComparator(const std::string& op, const std::string& leftOp,
+                                          const std::string& rightOp, const std::string& target,
+                                          LogicCircuit& circuit);
+    // Bits of a comparator operand, LSB first: a vector's bits or one parsed scalar
+    static std::vector<std::string> operandBits(const std::string& operand, LogicCircuit& circuit);
+    // Unsigned integer literal: 12, 4'd12, 'b1100, 8'h0c (underscores allowed, no x / z)
+    // (throws when the value needs more than 64 bits)
+    static bool parseIntegerLiteral(const std::string& text, uint64_t& value);
+    // Value of an integer literal of any width, LSB first, without leading zeros
+    static bool literalValue(const std::string& text, std::vector<bool>& value);
+    // Bits of a sized literal (4'b1010, 8'hff), MSB first, as constant nets
+    static bool literalBits(const std::string& text, std::vector<std::string>& bits);
+    // Operators whose result is built for a whole vector target at once
+    static bool isVectorArithmetic(const std::string& expr);
     
     // Helper functions for vector handling
     static std::string extractBaseName(const std::string& signal);
+    // Declared outputs, inputs and registers, plus the parser's internal vectors
     static bool isVectorBase(const std::string& name, const LogicCircuit& circuit);
     static std::vector<std::string> getVectorBits(const std::string& baseName, const LogicCircuit& circuit);
-    static std::string rewriteExpressionForBit(const std::string& expr, const std::string& baseName, 
-                                             const std::string& bitSignal, const LogicCircuit& circuit);
+    // Vectors an RHS can read as a whole (inputs, registers, internal vectors) by base
+    // name, bits MSB first
+    static std::unordered_map<std::string, std::vector<std::string>> getSourceVectors(const LogicCircuit& circuit);
+    // Fresh internal vector of `width` bits, returns its base name
+    static std::string newVector(size_t width, LogicCircuit& circuit);
+
+    // Vector-wide RHS of a `width`-bit target split once at every whole source-vector name
+    // and multi-bit sized literal; instance k puts bit k (MSB first) of each in its slot
+    struct BitTemplate {
+        std::vector<std::string> text;  // slotBits.size() + 1 literal pieces around the slots
+        std::vector<std::string> slotBase;
+        std::vector<const std::vector<std::string>*> slotBits;
+        std::vector<std::unique_ptr<std::vector<std::string>>> literals;  // constant bits of literal slots
+        std::string instantiate(size_t bit) const;
+    };
+    static BitTemplate makeBitTemplate(const std::string& expr,
+                                       const std::unordered_map<std::string, std::vector<std::string>>& vectors,
+                                       size_t width);
     static int getVectorWidth(const std::string& baseName, const LogicCircuit& circuit);
 
+    // Vector expressions are parsed into a tree with Verilog sizing (every operand is
+    // self-determined first, then evaluated at the width its context imposes) and lowered
+    // into the word-level graph of the running parse, which bit-blasts them when parsing
+    // is done (see WordGraph)
+    struct WordTerm {
+        enum class Kind { SIGNAL, LITERAL, UNARY, BINARY, TERNARY, CONCAT };
+        Kind kind = Kind::SIGNAL;
+        std::string op;
+        std::vector<std::string> bits;  // SIGNAL (a whole vector, bit- or part-select), LSB first
+        uint64_t value = 0;             // LITERAL
+        size_t width = 0;               // self-determined width
+        std::vector<WordTerm> args;     // TERNARY: {condition, then, else}; CONCAT: parts MSB first,
+                                        // a replication repeated
+    };
+    // Precedence climbing from `level` (0: ?:, then | ^ & equality relational shift
+    // additive multiplicative, unary). False on anything the word level does not model.
+    static bool parseWordTerm(const WordTokens& tokens, size_t& pos, int level, WordTerm& term,
+                              const LogicCircuit& circuit);
+    static int lowerWordTerm(const WordTerm& term, size_t width, WordGraph& graph);
+    // Whether a scalar RHS reads whole vectors, part-selects, concatenations or reductions
+    static bool isWordExpression(const std::string& rhs, const LogicCircuit& circuit);
+    // targets (MSB first) = rhs through the word graph; false when the RHS needs the
+    // per-bit path (logical operators, x / z literals)
+    static bool assignWord(const std::vector<std::string>& targets, const std::string& rhs, LogicCircuit& circuit);
+
+    // always / generate blocks
+    static std::string readVerilogBlock(std::ifstream& file, std::string& firstLine);
+    static void parseAlwaysBlock(const std::string& block, LogicCircuit& circuit);
+    static void parseGenerateBlock(const std::string& block, LogicCircuit& circuit);
+    static std::string evaluateGenerateExpression(std::string expr, const std::string& varName, int value);
+    static void parseForGenerate(const std::string& block, LogicCircuit& circuit);
+
+    // Always bodies are parsed into a statement tree, then executed symbolically: every
+    // target bit maps to the net holding its current value, and control flow merges those
+    // maps with multiplexers. A non-blocking assignment sets the bit's next state instead,
+    // which later reads in the block do not see.
+    struct Statement {
+        enum class Kind { BLOCK, ASSIGN, IF, CASE };
+        Kind kind = Kind::BLOCK;
+        std::string lhs;                               // ASSIGN target
+        std::string expr;                              // ASSIGN value, IF condition, CASE selector
+        bool nonBlocking = false;
+        char wildcards = 0;                            // CASE: 'z' for casez, 'x' for casex
+        std::vector<Statement> body;                   // BLOCK statements, IF {then, else}, CASE items
+        std::vector<std::vector<std::string>> labels;  // CASE: labels per item, empty for default
+    };
+    // A target bit's value; `mayHold` when some path so far leaves the bit unassigned,
+    // which makes it a latch if that is still true at the end of the block
+    struct BitValue {
+        std::string net;
+        bool mayHold = false;
+    };
+    using BitValues = std::map<std::string, BitValue>;
+
+    static Statement parseStatement(const std::string& text, size_t& pos);
+    static void executeStatement(const Statement& statement, BitValues& values, LogicCircuit& circuit);
+    static void executeCase(const Statement& statement, BitValues& values, LogicCircuit& circuit);
+    // Rewrites reads of bits the block has assigned into their current nets; a whole
+    // vector with assigned bits becomes an internal vector of its current value
+    static std::string substituteValues(const std::string& expr, const BitValues& values, LogicCircuit& circuit);
+    // Bits (MSB first) of an assignment target: a signal, a bit- or part-select, or a
+    // concatenation of those
+    static std::vector<std::string> targetBits(const std::string& lhs, const LogicCircuit& circuit);
+    // Value of `bit` in `values`; an unassigned bit reads its previous value (`hold`)
+    static const BitValue& valueOf(const BitValues& values, const std::string& bit, BitValue& hold);
+    // Balanced MUX tree over the select bits for leaves[lo, lo + size), one leaf per select
+    // value; a subtree whose leaves all agree costs nothing
+    static BitValue muxTree(const std::vector<BitValue>& leaves, size_t lo, size_t size,
+                            const std::vector<std::string>& select, LogicCircuit& circuit);
+    // Case label as a pattern over `width` selector bits: care has a 1 for every bit that
+    // must equal value. False for labels that are not constants.
+    static bool parseCaseLabel(const std::string& label, char wildcards, size_t width,
+                               uint64_t& value, uint64_t& care);
+
 public:
-    static LogicCircuit parse(const std::string& filename);
+    // Print DEBUG traces of every parsed statement to stdout
+    static bool verbose;
+    // Architecture of every vector adder and subtractor built by parse
+    static AdderArchitecture adderArchitecture;
+    static MultiplierArchitecture multiplierArchitecture;
+    // Sort each partial-product column by operand names, so a * b and b * a (or two
+    // multipliers over the same operands) reduce identically and hash together in a miter
+    static bool canonicalPartialProducts;
+    // Lower `==` / `!=` to one EQ gate, encoded without per-bit XNOR variables
+    static bool directComparators;
+
+    // Vector logic is bit-blasted only for the bits in the fanin of `observed` (for all
+    // of it when empty); signals outside those cones may be left undriven
+    static LogicCircuit parse(const std::string& filename, const std::vector<std::string>& observed = {});
 };
 
 #endif // VER2CNF_H
\ No newline at end of file
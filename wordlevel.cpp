@@ -0,0 +1,534 @@
+#include "wordlevel.h"
+#include "arithmetic.h"
+
+// ---------------- WordGraph ----------------
+namespace {
+
+uint64_t widthMask(size_t width) { return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1; }
+
+bool isComparison(WordGraph::Op op) {
+    return op == WordGraph::Op::EQ || op == WordGraph::Op::NE || op == WordGraph::Op::LT ||
+           op == WordGraph::Op::LE || op == WordGraph::Op::GT || op == WordGraph::Op::GE;
+}
+
+bool isShift(WordGraph::Op op) {
+    return op == WordGraph::Op::SHL || op == WordGraph::Op::SHR;
+}
+
+bool isCommutative(WordGraph::Op op) {
+    return op == WordGraph::Op::AND || op == WordGraph::Op::OR || op == WordGraph::Op::XOR ||
+           op == WordGraph::Op::XNOR || op == WordGraph::Op::ADD || op == WordGraph::Op::MUL ||
+           op == WordGraph::Op::EQ || op == WordGraph::Op::NE;
+}
+
+// a <op> b on constants of `width` <= 64 bits (comparisons give 0 / 1)
+uint64_t evaluate(WordGraph::Op op, uint64_t a, uint64_t b, size_t width) {
+    uint64_t mask = widthMask(width);
+    switch (op) {
+        case WordGraph::Op::AND:  return a & b;
+        case WordGraph::Op::OR:   return a | b;
+        case WordGraph::Op::XOR:  return a ^ b;
+        case WordGraph::Op::XNOR: return ~(a ^ b) & mask;
+        case WordGraph::Op::ADD:  return (a + b) & mask;
+        case WordGraph::Op::SUB:  return (a - b) & mask;
+        case WordGraph::Op::MUL:  return (a * b) & mask;
+        case WordGraph::Op::EQ:   return a == b;
+        case WordGraph::Op::NE:   return a != b;
+        case WordGraph::Op::LT:   return a < b;
+        case WordGraph::Op::LE:   return a <= b;
+        case WordGraph::Op::GT:   return a > b;
+        case WordGraph::Op::GE:   return a >= b;
+        case WordGraph::Op::SHL:  return b >= width ? 0 : (a << b) & mask;
+        case WordGraph::Op::SHR:  return b >= width ? 0 : a >> b;
+        default: return 0;
+    }
+}
+
+// One bit-level gate over nets, folded like LogicCircuit::addGate folds; a gate that
+// folds to a wire or a constant costs nothing
+std::string bitGate(LogicCircuit& circuit, Gate::Type type, const std::vector<std::string>& in) {
+    Gate gate = LogicCircuit::simplify(Gate(type, in, ""));
+    if (gate.type == Gate::Type::BUF) return gate.inputs[0];
+    std::string out = circuit.newTemp();
+    circuit.addGate(Gate(gate.type, gate.inputs, out));
+    return out;
+}
+
+} // namespace
+
+int WordGraph::make(Node node) {
+    std::string key = std::to_string(static_cast<int>(node.op)) + ":" + std::to_string(node.width) + ":" +
+                      std::to_string(node.value);
+    for (int arg : node.args) key += "," + std::to_string(arg);
+    for (const auto& bit : node.bits) key += "|" + bit;
+    auto found = table.find(key);
+    if (found != table.end()) return found->second;
+    nodes.push_back(std::move(node));
+    int id = static_cast<int>(nodes.size() - 1);
+    table.emplace(key, id);
+    return id;
+}
+
+bool WordGraph::isConstant(int id, uint64_t& value) const {
+    value = nodes[id].value;
+    return nodes[id].op == Op::CONST;
+}
+
+int WordGraph::leaf(const std::vector<std::string>& bits) {
+    if (bits.empty()) throw std::runtime_error("Empty word operand");
+    return make({Op::LEAF, bits.size(), {}, bits, 0});
+}
+
+int WordGraph::constant(uint64_t value, size_t width, bool high) {
+    if (width <= 64) return make({Op::CONST, width, {}, {}, value & widthMask(width)});
+    std::vector<std::string> bits;
+    for (size_t i = 0; i < width; i++) {
+        bool bit = i < 64 ? (value >> i & 1) : high;
+        bits.push_back(bit ? LogicCircuit::kConst1 : LogicCircuit::kConst0);
+    }
+    return leaf(bits);
+}
+
+int WordGraph::resize(int id, size_t width, bool signExtend) {
+    Node n = nodes[id];
+    if (n.width == width) return id;
+    if (n.op == Op::CONST) {
+        bool fill = signExtend && width > n.width && (n.value >> (n.width - 1) & 1);
+        return constant(n.value | (fill ? ~widthMask(n.width) : 0), width, fill);
+    }
+    if (width < n.width) {
+        // Truncation: low bits of a leaf or a concatenation, or of whatever an extension extended
+        if (n.op == Op::LEAF) return leaf(std::vector<std::string>(n.bits.begin(), n.bits.begin() + width));
+        if (n.op == Op::CONCAT) {
+            std::vector<int> low;
+            size_t covered = 0;
+            for (size_t p = n.args.size(); covered < width; p--) {
+                size_t take = std::min(nodes[n.args[p - 1]].width, width - covered);
+                low.insert(low.begin(), resize(n.args[p - 1], take));
+                covered += take;
+            }
+            return concat(low);
+        }
+        if ((n.op == Op::ZEXT || n.op == Op::SEXT) && nodes[n.args[0]].width >= width) return resize(n.args[0], width);
+    } else if (n.op == Op::ZEXT && nodes[n.args[0]].width < n.width) {
+        return resize(n.args[0], width);
+    }
+    return make({signExtend && width > n.width ? Op::SEXT : Op::ZEXT, width, {id}, {}, 0});
+}
+
+int WordGraph::unary(Op op, int a) {
+    Node n = nodes[a];
+    uint64_t value;
+    if (isConstant(a, value)) return constant(~value, n.width);
+    if (n.op == Op::NOT) return n.args[0];
+    if (n.op == Op::MUX) {
+        int pushed = pushMux(op, a, -1, true);
+        if (pushed >= 0) return pushed;
+    }
+    return make({op, n.width, {a}, {}, 0});
+}
+
+int WordGraph::reduce(Op op, int a) {
+    Node n = nodes[a];
+    uint64_t value;
+    if (n.width == 1) return a;
+    if (isConstant(a, value) && n.width <= 64) {
+        bool bit = op == Op::REDAND ? value == widthMask(n.width) : op == Op::REDOR ? value != 0
+                 : __builtin_parityll(value);
+        return constant(bit, 1);
+    }
+    // Zero extension adds 0 bits: the AND is 0, OR and XOR ignore them
+    if (n.op == Op::ZEXT) return op == Op::REDAND ? constant(0, 1) : reduce(op, n.args[0]);
+    return make({op, 1, {a}, {}, 0});
+}
+
+int WordGraph::binary(Op op, int a, int b) {
+    if (isCommutative(op) && b < a) std::swap(a, b);
+    size_t width = nodes[a].width;
+    if (isShift(op)) {
+        uint64_t amount, value;
+        if (!isConstant(b, amount)) return make({op, width, {a, b}, {}, 0});
+        if (amount == 0) return a;
+        if (isConstant(a, value) && width <= 64) return constant(evaluate(op, value, amount, width), width);
+        if (amount >= width) return constant(0, width);
+        return make({op, width, {a, b}, {}, 0});
+    }
+    if (nodes[b].width != width) throw std::runtime_error("Word operand width mismatch");
+    size_t resultWidth = isComparison(op) ? 1 : width;
+    uint64_t mask = widthMask(width);
+    uint64_t x, y;
+    bool constA = isConstant(a, x), constB = isConstant(b, y);
+
+    if (constA && constB && width <= 64) return constant(evaluate(op, x, y, width), resultWidth);
+    if (a == b) {
+        switch (op) {
+            case Op::AND: case Op::OR: return a;
+            case Op::XOR: case Op::SUB: return constant(0, width);
+            case Op::XNOR: return constant(~uint64_t(0), width, true);
+            case Op::EQ: case Op::LE: case Op::GE: return constant(1, 1);
+            case Op::NE: case Op::LT: case Op::GT: return constant(0, 1);
+            default: break;
+        }
+    }
+    if (isComparison(op) && (constA || constB)) {
+        // A zero-extended operand against a constant: compare at the operand's own width,
+        // or decide outright when the constant does not fit in it
+        int other = constA ? b : a;
+        uint64_t c = constA ? x : y;
+        if (nodes[other].op == Op::ZEXT && nodes[nodes[other].args[0]].width < width) {
+            int narrow = nodes[other].args[0];
+            size_t narrowWidth = nodes[narrow].width;
+            if (narrowWidth < 64 && (c >> narrowWidth) == 0) {
+                int k = constant(c, narrowWidth);
+                return constA ? binary(op, k, narrow) : binary(op, narrow, k);
+            }
+            if (narrowWidth < 64) {
+                // The operand is always below the constant
+                bool operandLeft = !constA;
+                switch (op) {
+                    case Op::EQ: return constant(0, 1);
+                    case Op::NE: return constant(1, 1);
+                    case Op::LT: case Op::LE: return constant(operandLeft, 1);
+                    default: return constant(!operandLeft, 1);
+                }
+            }
+        }
+    }
+    if (constA || constB) {
+        int other = constA ? b : a;
+        uint64_t c = constA ? x : y;
+        bool ones = width <= 64 && c == mask;
+        switch (op) {
+            case Op::AND:
+                if (c == 0) return constant(0, width);
+                if (ones) return other;
+                break;
+            case Op::OR:
+                if (c == 0) return other;
+                if (ones) return constant(mask, width);
+                break;
+            case Op::XOR:
+                if (c == 0) return other;
+                if (ones) return unary(Op::NOT, other);
+                break;
+            case Op::XNOR:
+                if (ones) return other;
+                if (c == 0) return unary(Op::NOT, other);
+                break;
+            case Op::ADD:
+                if (c == 0) return other;
+                break;
+            case Op::SUB:
+                if (constB && c == 0) return a;
+                break;
+            case Op::MUL:
+                if (c == 0) return constant(0, width);
+                if (c == 1) return other;
+                break;
+            default:
+                break;
+        }
+    }
+    if (nodes[a].op == Op::MUX) {
+        int pushed = pushMux(op, a, b, true);
+        if (pushed >= 0) return pushed;
+    }
+    if (nodes[b].op == Op::MUX) {
+        int pushed = pushMux(op, b, a, false);
+        if (pushed >= 0) return pushed;
+    }
+    return make({op, resultWidth, {a, b}, {}, 0});
+}
+
+int WordGraph::pushMux(Op op, int muxNode, int other, bool muxFirst) {
+    std::vector<int> args = nodes[muxNode].args;
+    auto apply = [&](int arm) {
+        if (other < 0) return unary(op, arm);
+        return muxFirst ? binary(op, arm, other) : binary(op, other, arm);
+    };
+    auto folded = [&](int result) {
+        return nodes[result].op == Op::CONST || result == args[0] || result == args[1] || result == other;
+    };
+    int low = apply(args[0]), high = apply(args[1]);
+    if (!folded(low) && !folded(high)) return -1;
+    return mux(args[2], low, high);
+}
+
+int WordGraph::mux(int sel, int a, int b) {
+    uint64_t value;
+    if (nodes[sel].width != 1 || nodes[a].width != nodes[b].width) throw std::runtime_error("Word MUX width mismatch");
+    if (isConstant(sel, value)) return value ? b : a;
+    if (a == b) return a;
+    if (nodes[sel].op == Op::NOT) return mux(nodes[sel].args[0], b, a);
+    uint64_t x, y;
+    if (nodes[a].width == 1 && isConstant(a, x) && isConstant(b, y)) return y ? sel : unary(Op::NOT, sel);
+    return make({Op::MUX, nodes[a].width, {a, b, sel}, {}, 0});
+}
+
+int WordGraph::concat(const std::vector<int>& parts) {
+    if (parts.empty()) throw std::runtime_error("Empty concatenation");
+    std::vector<int> merged;
+    size_t width = 0;
+    for (int part : parts) {
+        const Node& n = nodes[part];
+        if (n.op == Op::CONCAT) {
+            for (int inner : std::vector<int>(n.args)) merged.push_back(inner);
+        } else {
+            merged.push_back(part);
+        }
+        width += nodes[part].width;
+    }
+    // Merge neighbours, the more significant one first
+    std::vector<int> kept;
+    for (int part : merged) {
+        if (!kept.empty()) {
+            Node high = nodes[kept.back()], low = nodes[part];
+            if (high.op == Op::LEAF && low.op == Op::LEAF) {
+                std::vector<std::string> bits = low.bits;
+                bits.insert(bits.end(), high.bits.begin(), high.bits.end());
+                kept.back() = leaf(bits);
+                continue;
+            }
+            if (high.op == Op::CONST && low.op == Op::CONST && high.width + low.width <= 64) {
+                kept.back() = constant(high.value << low.width | low.value, high.width + low.width);
+                continue;
+            }
+        }
+        kept.push_back(part);
+    }
+    if (kept.size() == 1) return kept[0];
+    return make({Op::CONCAT, width, kept, {}, 0});
+}
+
+std::pair<int, size_t> WordGraph::concatSource(const Node& node, size_t bit) const {
+    for (size_t p = node.args.size(); p-- > 0;) {
+        size_t width = nodes[node.args[p]].width;
+        if (bit < width) return {node.args[p], bit};
+        bit -= width;
+    }
+    throw std::runtime_error("Concatenation bit out of range");
+}
+
+void WordGraph::define(const std::string& signal, int node, size_t bit) {
+    auto inserted = definitions.emplace(signal, std::make_pair(node, bit));
+    if (!inserted.second && inserted.first->second != std::make_pair(node, bit)) {
+        throw std::runtime_error("Multiple drivers for " + signal);
+    }
+}
+
+size_t WordGraph::blast(LogicCircuit& circuit, const std::vector<std::string>& roots, const Lowering& lowering) {
+    // Demand: the node bits the roots observe, traced through the gates already in the
+    // circuit and through the word graph itself
+    std::unordered_map<std::string, size_t> driver;
+    for (size_t g = 0; g < circuit.gates.size(); g++) driver.emplace(circuit.gates[g].output, g);
+    std::vector<std::vector<bool>> demanded(nodes.size());
+    std::vector<std::string> signals = roots;
+    if (signals.empty()) {
+        for (const auto& definition : definitions) signals.push_back(definition.first);
+    }
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> driven;
+    std::vector<std::pair<int, size_t>> pending;
+    while (!signals.empty() || !pending.empty()) {
+        if (pending.empty()) {
+            std::string signal = signals.back();
+            signals.pop_back();
+            if (!seen.insert(signal).second) continue;
+            auto definition = definitions.find(signal);
+            if (definition != definitions.end()) {
+                driven.push_back(signal);
+                pending.push_back(definition->second);
+            } else {
+                auto gate = driver.find(signal);
+                if (gate == driver.end()) continue;
+                for (const auto& in : circuit.gates[gate->second].inputs) signals.push_back(in);
+            }
+            continue;
+        }
+        auto [id, i] = pending.back();
+        pending.pop_back();
+        std::vector<bool>& want = demanded[id];
+        if (want.empty()) want.assign(nodes[id].width, false);
+        if (want[i]) continue;
+        want[i] = true;
+
+        const Node& n = nodes[id];
+        auto all = [&](int arg) {
+            for (size_t j = 0; j < nodes[arg].width; j++) pending.push_back({arg, j});
+        };
+        uint64_t amount;
+        switch (n.op) {
+            case Op::LEAF:
+                signals.push_back(n.bits[i]);
+                break;
+            case Op::CONST:
+                break;
+            case Op::ZEXT:
+                if (i < nodes[n.args[0]].width) pending.push_back({n.args[0], i});
+                break;
+            case Op::SEXT:
+                pending.push_back({n.args[0], std::min(i, nodes[n.args[0]].width - 1)});
+                break;
+            case Op::NOT: case Op::AND: case Op::OR: case Op::XOR: case Op::XNOR:
+                for (int arg : n.args) pending.push_back({arg, i});
+                break;
+            case Op::ADD: case Op::SUB: case Op::MUL:
+                // Bit i of a sum or product depends on operand bits 0..i only
+                for (size_t j = 0; j <= i; j++) {
+                    pending.push_back({n.args[0], j});
+                    pending.push_back({n.args[1], j});
+                }
+                break;
+            case Op::SHL: case Op::SHR:
+                if (!isConstant(n.args[1], amount)) {
+                    all(n.args[0]);
+                    all(n.args[1]);
+                } else if (n.op == Op::SHL) {
+                    if (i >= amount) pending.push_back({n.args[0], i - amount});
+                } else if (amount < n.width - i) {
+                    pending.push_back({n.args[0], i + amount});
+                }
+                break;
+            case Op::MUX:
+                pending.push_back({n.args[0], i});
+                pending.push_back({n.args[1], i});
+                pending.push_back({n.args[2], 0});
+                break;
+            case Op::CONCAT:
+                pending.push_back(concatSource(n, i));
+                break;
+            case Op::REDAND: case Op::REDOR: case Op::REDXOR:
+                all(n.args[0]);
+                break;
+            default:  // comparisons
+                all(n.args[0]);
+                all(n.args[1]);
+                break;
+        }
+    }
+
+    // Nodes come after their operands, so one pass in id order builds every demanded bit
+    std::vector<std::vector<std::string>> nets(nodes.size());
+    for (size_t id = 0; id < nodes.size(); id++) {
+        const std::vector<bool>& want = demanded[id];
+        if (want.empty()) continue;
+        const Node& n = nodes[id];
+        std::vector<std::string>& out = nets[id];
+        out.assign(n.width, "");
+        size_t prefix = n.width;
+        while (!want[prefix - 1]) prefix--;
+        auto bits = [&](int arg, size_t count) {
+            return std::vector<std::string>(nets[arg].begin(), nets[arg].begin() + count);
+        };
+        auto temps = [&](size_t count) {
+            std::vector<std::string> result(count);
+            for (auto& t : result) t = circuit.newTemp();
+            return result;
+        };
+        uint64_t amount;
+        switch (n.op) {
+            case Op::LEAF:
+                for (size_t i = 0; i < n.width; i++) if (want[i]) out[i] = n.bits[i];
+                break;
+            case Op::CONST:
+                for (size_t i = 0; i < n.width; i++) {
+                    if (want[i]) out[i] = i < 64 && (n.value >> i & 1) ? LogicCircuit::kConst1 : LogicCircuit::kConst0;
+                }
+                break;
+            case Op::CONCAT:
+                for (size_t i = 0; i < n.width; i++) {
+                    if (!want[i]) continue;
+                    auto [part, bit] = concatSource(n, i);
+                    out[i] = nets[part][bit];
+                }
+                break;
+            case Op::ZEXT: case Op::SEXT: {
+                const std::vector<std::string>& a = nets[n.args[0]];
+                for (size_t i = 0; i < n.width; i++) {
+                    if (!want[i]) continue;
+                    out[i] = i < a.size() ? a[i] : n.op == Op::SEXT ? a.back() : LogicCircuit::kConst0;
+                }
+                break;
+            }
+            case Op::NOT: case Op::AND: case Op::OR: case Op::XOR: case Op::XNOR: {
+                Gate::Type type = n.op == Op::NOT ? Gate::Type::NOT : n.op == Op::AND ? Gate::Type::AND
+                                : n.op == Op::OR ? Gate::Type::OR : n.op == Op::XOR ? Gate::Type::XOR
+                                : Gate::Type::XNOR;
+                for (size_t i = 0; i < n.width; i++) {
+                    if (!want[i]) continue;
+                    std::vector<std::string> in;
+                    for (int arg : n.args) in.push_back(nets[arg][i]);
+                    out[i] = bitGate(circuit, type, in);
+                }
+                break;
+            }
+            case Op::REDAND: case Op::REDOR: case Op::REDXOR:
+                out[0] = bitGate(circuit, n.op == Op::REDAND ? Gate::Type::AND : n.op == Op::REDOR ? Gate::Type::OR
+                                        : Gate::Type::XOR, nets[n.args[0]]);
+                break;
+            case Op::MUX:
+                for (size_t i = 0; i < n.width; i++) {
+                    if (want[i]) out[i] = bitGate(circuit, Gate::Type::MUX, {nets[n.args[0]][i], nets[n.args[1]][i],
+                                                                             nets[n.args[2]][0]});
+                }
+                break;
+            case Op::ADD: case Op::SUB: {
+                // Only the demanded low bits: a prefix-width adder
+                std::vector<std::string> a = bits(n.args[0], prefix), b = bits(n.args[1], prefix);
+                if (n.op == Op::SUB) {
+                    for (auto& bit : b) bit = bitGate(circuit, Gate::Type::NOT, {bit});
+                }
+                std::vector<std::string> sum = temps(prefix);
+                ArithmeticBuilder::add(circuit, a, b, n.op == Op::SUB, sum, lowering.adder);
+                std::copy(sum.begin(), sum.end(), out.begin());
+                break;
+            }
+            case Op::MUL: {
+                std::vector<std::string> product = temps(prefix);
+                ArithmeticBuilder::multiply(circuit, bits(n.args[0], prefix), bits(n.args[1], prefix), product,
+                                            lowering.multiplier, lowering.canonicalPartialProducts, lowering.adder);
+                std::copy(product.begin(), product.end(), out.begin());
+                break;
+            }
+            case Op::SHL: case Op::SHR: {
+                const std::vector<std::string>& a = nets[n.args[0]];
+                ArithmeticBuilder::ShiftKind kind = n.op == Op::SHL ? ArithmeticBuilder::ShiftKind::LEFT
+                                                                    : ArithmeticBuilder::ShiftKind::RIGHT;
+                if (!isConstant(n.args[1], amount)) {
+                    std::vector<std::string> result = temps(n.width);
+                    ArithmeticBuilder::shift(circuit, a, nets[n.args[1]], kind, result);
+                    out = result;
+                    break;
+                }
+                // Constant amounts are rewiring only
+                for (size_t i = 0; i < n.width; i++) {
+                    if (!want[i]) continue;
+                    if (n.op == Op::SHL) out[i] = i >= amount ? a[i - amount] : LogicCircuit::kConst0;
+                    else if (amount < n.width - i) out[i] = a[i + amount];
+                    else out[i] = LogicCircuit::kConst0;
+                }
+                break;
+            }
+            default: {
+                ArithmeticBuilder::Comparison comparison =
+                    n.op == Op::EQ ? ArithmeticBuilder::Comparison::EQ : n.op == Op::NE ? ArithmeticBuilder::Comparison::NE
+                  : n.op == Op::LT ? ArithmeticBuilder::Comparison::LT : n.op == Op::LE ? ArithmeticBuilder::Comparison::LE
+                  : n.op == Op::GT ? ArithmeticBuilder::Comparison::GT : ArithmeticBuilder::Comparison::GE;
+                out[0] = circuit.newTemp();
+                ArithmeticBuilder::compare(circuit, nets[n.args[0]], nets[n.args[1]], comparison, out[0],
+                                           lowering.directComparators);
+                break;
+            }
+        }
+    }
+
+    // Gates that read a defined signal before it had a driver took it for an input
+    for (const auto& definition : definitions) circuit.inputs.erase(definition.first);
+    std::sort(driven.begin(), driven.end());
+    for (const auto& signal : driven) {
+        const auto& definition = definitions.at(signal);
+        const std::string& net = nets[definition.first][definition.second];
+        if (net != signal) circuit.addGate(Gate(Gate::Type::BUF, {net}, signal));
+    }
+    return driven.size();
+}
@@ -0,0 +1,82 @@
+#ifndef WORDLEVEL_H
+#define WORDLEVEL_H
+
+#include "ver2cnf.h"
+
+// ---------------- WordGraph ----------------
+// Word-level netlist of the vector expressions of a module. Every node is a bit vector
+// (LSB first) with a width; nodes are hash-consed and rewritten as they are made:
+// constant folding, x - x = 0, x & x = x, x == x = 1, comparisons against constants
+// narrowed to the operand width, constant MUX selects, and MUXes pushed through an
+// operator when that folds one of the arms. Nothing becomes gates until blast(), which
+// builds only the bits the requested signals observe: the low k bits of a sum or
+// product cost a k-bit adder or multiplier, a constant shift costs no gate at all.
+// Leaves, part-selects and concatenations are views: they only name which existing
+// bits a word consists of and never become gates.
+class WordGraph {
+public:
+    enum class Op {
+        LEAF, CONST, ZEXT, SEXT, NOT, AND, OR, XOR, XNOR, ADD, SUB, MUL,
+        EQ, NE, LT, LE, GT, GE, SHL, SHR, MUX, CONCAT, REDAND, REDOR, REDXOR
+    };
+    struct Node {
+        Op op;
+        size_t width;
+        std::vector<int> args;           // MUX: {a, b, sel}, sel ? b : a like Gate::Type::MUX;
+                                         // CONCAT: parts, most significant first
+        std::vector<std::string> bits;   // LEAF signals, LSB first
+        uint64_t value = 0;              // CONST, at most 64 bits wide
+    };
+    // How word operators become gates (see ArithmeticBuilder)
+    struct Lowering {
+        AdderArchitecture adder;
+        MultiplierArchitecture multiplier;
+        bool canonicalPartialProducts;
+        bool directComparators;
+    };
+
+    int leaf(const std::vector<std::string>& bits);
+    // Bits past the 64th are all `high`. A constant wider than 64 bits is a leaf of constant
+    // nets: the word rewrites leave it alone and blast() folds it bit by bit.
+    int constant(uint64_t value, size_t width, bool high = false);
+    // Zero- or sign-extends, or truncates, to `width`
+    int resize(int node, size_t width, bool signExtend = false);
+    int unary(Op op, int a);
+    // REDAND, REDOR or REDXOR of all bits of `a`, 1 bit wide; blasted into a single n-ary
+    // gate (the CNF encoder splits a wide XOR into --xor-cut input blocks)
+    int reduce(Op op, int a);
+    // Bitwise and arithmetic operands share the result width; comparisons are 1 bit wide;
+    // a shift keeps the width of `a` and takes any amount width
+    int binary(Op op, int a, int b);
+    // sel ? b : a, with a 1-bit sel
+    int mux(int sel, int a, int b);
+    // {parts[0], parts[1], ...}: adjacent leaves merge into one leaf, adjacent constants
+    // into one constant
+    int concat(const std::vector<int>& parts);
+    const Node& node(int id) const { return nodes[id]; }
+    size_t size() const { return nodes.size(); }
+
+    // `signal` is bit `bit` of `node`
+    void define(const std::string& signal, int node, size_t bit);
+    size_t definedBits() const { return definitions.size(); }
+
+    // Drives the defined signals in the fanin of `roots` (of every defined signal when
+    // `roots` is empty), creating gates only for the node bits they depend on. Returns
+    // the number of defined signals driven.
+    size_t blast(LogicCircuit& circuit, const std::vector<std::string>& roots, const Lowering& lowering);
+
+private:
+    std::vector<Node> nodes;
+    std::unordered_map<std::string, int> table;
+    std::unordered_map<std::string, std::pair<int, size_t>> definitions;
+
+    int make(Node node);
+    bool isConstant(int id, uint64_t& value) const;
+    // Part of a CONCAT node holding its bit `bit`, and the bit's index in that part
+    std::pair<int, size_t> concatSource(const Node& node, size_t bit) const;
+    // Rewrites op(mux(s, p, q), other) into mux(s, op(p, other), op(q, other)) when one
+    // of the new arms folds; -1 if it does not pay off
+    int pushMux(Op op, int muxNode, int other, bool muxFirst);
+};
+
+#endif // WORDLEVEL_H